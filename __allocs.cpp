@@ -0,0 +1,221 @@
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+#include "_allocs.h"
+#include "include/GScheduler.h"
+
+namespace {
+
+// guards gRecords and the fAllocs of every CanvasStats
+std::mutex gMutex;
+
+// The innermost scope is the thread's task context, so that the pool carries it to whichever
+// worker runs work the scope's draw hands off.
+const AllocScope *current_scope() {
+    return static_cast<const AllocScope *>(GGetTaskContext());
+}
+
+#ifdef G_ALLOC_TRACKING
+
+struct AllocRecord {
+    size_t fSize;
+    CanvasStats *fStats;
+    int fPrimitive;
+};
+
+std::atomic<bool> gTracking{false};
+// the records in gRecords: while there are none, frees skip the lock and the lookup
+std::atomic<size_t> gLiveRecords{0};
+
+// never freed, so that frees during static destruction still find it
+std::unordered_map<void *, AllocRecord> *gRecords;
+// set while the tracker itself is allocating, so that its own map nodes are not tracked
+thread_local bool tInTracker = false;
+
+void note_alloc(void *ptr, size_t size) {
+    const AllocScope *scope = current_scope();
+    if (!ptr || !scope || tInTracker || !gTracking.load(std::memory_order_relaxed)) {
+        return;
+    }
+    tInTracker = true;
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        if (!gRecords) {
+            gRecords = new std::unordered_map<void *, AllocRecord>;
+        }
+        if (gRecords->insert_or_assign(ptr, AllocRecord{size, scope->stats(), scope->primitive()}).second) {
+            gLiveRecords.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        CanvasStats::AllocCounters &c = scope->stats()->fAllocs[scope->primitive()];
+        c.fCount += 1;
+        c.fBytes += size;
+        c.fLiveBytes += size;
+        c.fPeakBytes = std::max(c.fPeakBytes, c.fLiveBytes);
+    }
+    tInTracker = false;
+}
+
+void note_free(void *ptr) {
+    if (!ptr || tInTracker || gLiveRecords.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    tInTracker = true;
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        if (gRecords) {
+            auto found = gRecords->find(ptr);
+            if (found != gRecords->end()) {
+                const AllocRecord &rec = found->second;
+                rec.fStats->fAllocs[rec.fPrimitive].fLiveBytes -= rec.fSize;
+                gRecords->erase(found);
+                gLiveRecords.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    tInTracker = false;
+}
+
+#endif
+
+}  // namespace
+
+#ifdef G_ALLOC_TRACKING
+
+void GSetAllocTracking(bool enabled) {
+    gTracking.store(enabled);
+}
+
+bool GGetAllocTracking() {
+    return gTracking.load();
+}
+
+#else
+
+void GSetAllocTracking(bool) {}
+
+bool GGetAllocTracking() {
+    return false;
+}
+
+#endif
+
+AllocScope::AllocScope(CanvasStats *stats, GCanvasStats::Primitive primitive)
+    : fStats(stats), fPrimitive(primitive), fActive(!current_scope()) {
+    if (fActive) {
+        GSetTaskContext(this);
+    }
+}
+
+AllocScope::~AllocScope() {
+    if (fActive) {
+        GSetTaskContext(nullptr);
+    }
+}
+
+void ReadAllocs(const CanvasStats &stats, GCanvasStats::Allocations out[]) {
+    std::lock_guard<std::mutex> lock(gMutex);
+    for (int i = 0; i < GCanvasStats::kPrimitiveCount; i++) {
+        const CanvasStats::AllocCounters &c = stats.fAllocs[i];
+        out[i] = {c.fCount, c.fBytes, c.fPeakBytes, c.fLiveBytes};
+    }
+}
+
+void ResetAllocs(CanvasStats *stats) {
+    std::lock_guard<std::mutex> lock(gMutex);
+    for (CanvasStats::AllocCounters &c : stats->fAllocs) {
+        c.fCount = 0;
+        c.fBytes = 0;
+        c.fPeakBytes = c.fLiveBytes;
+    }
+}
+
+void ForgetAllocs(CanvasStats *stats) {
+#ifdef G_ALLOC_TRACKING
+    if (gLiveRecords.load() == 0) {
+        return;
+    }
+    bool wasInTracker = tInTracker;
+    tInTracker = true;
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        if (gRecords) {
+            for (auto it = gRecords->begin(); it != gRecords->end();) {
+                if (it->second.fStats == stats) {
+                    it = gRecords->erase(it);
+                    gLiveRecords.fetch_sub(1, std::memory_order_relaxed);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+    tInTracker = wasInTracker;
+#else
+    (void)stats;
+#endif
+}
+
+#ifdef G_ALLOC_TRACKING
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Every form is replaced, so that none of them falls through to another runtime's version (e.g.
+// a sanitizer's) and mismatches with these.
+
+static void *tracked_new(size_t size) {
+    void *ptr = malloc(size ? size : 1);
+    if (ptr) {
+        note_alloc(ptr, size);
+    }
+    return ptr;
+}
+
+static void *tracked_new(size_t size, std::align_val_t align) {
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, std::max(sizeof(void *), (size_t)align), size ? size : 1)) {
+        return nullptr;
+    }
+    note_alloc(ptr, size);
+    return ptr;
+}
+
+static void tracked_delete(void *ptr) {
+    note_free(ptr);
+    free(ptr);
+}
+
+static void *throwing(void *ptr) {
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new(size_t size) { return throwing(tracked_new(size)); }
+void *operator new[](size_t size) { return throwing(tracked_new(size)); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return tracked_new(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return tracked_new(size); }
+void *operator new(size_t size, std::align_val_t align) { return throwing(tracked_new(size, align)); }
+void *operator new[](size_t size, std::align_val_t align) { return throwing(tracked_new(size, align)); }
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return tracked_new(size, align);
+}
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return tracked_new(size, align);
+}
+
+void operator delete(void *ptr) noexcept { tracked_delete(ptr); }
+void operator delete[](void *ptr) noexcept { tracked_delete(ptr); }
+void operator delete(void *ptr, size_t) noexcept { tracked_delete(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { tracked_delete(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { tracked_delete(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { tracked_delete(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { tracked_delete(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { tracked_delete(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { tracked_delete(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { tracked_delete(ptr); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { tracked_delete(ptr); }
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { tracked_delete(ptr); }
+
+#endif
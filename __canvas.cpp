@@ -1,22 +1,45 @@
 //
 // Created by Affan Naushahi on 1/21/24.
 //
+#include "_allocs.h"
 #include "_blend.h"
 #include "_canvas.h"
 #include "_clipping.h"
 #include "_compositeShader.h"
 #include "_curves.h"
+#include "_gradientShader.h"
 #include "_proxyShader.h"
 #include "_shader.h"
 #include "_triColorShader.h"
+#include "include/GScheduler.h"
+#include "include/GTrace.h"
 
 void MyCanvas::save() {
     ctmStack.push(ctmStack.top());
+    fClipStack.push(fClipStack.top());
 }
 
-// restore the current CTM (pop the top of the stack and set it as the current CTM)
+// restore the current CTM and clip (pop the top of the stacks)
 void MyCanvas::restore() {
     ctmStack.pop();
+    fClipStack.pop();
+    if (ctmStack.size() == 1) {
+        fArena.reset();
+    }
+}
+
+void MyCanvas::flush() {
+    fLazyClear.resolve();
+    fArena.reset();
+}
+
+// bytes the arena may hold between resets before draws start recycling it
+static const size_t kArenaBudget = 8 << 20;
+
+void MyCanvas::recycleArena() {
+    if (fArena.bytesUsed() > kArenaBudget) {
+        fArena.reset();
+    }
 }
 
 // new top of stack = top of stack * matrix
@@ -27,24 +50,255 @@ void MyCanvas::concat(const GMatrix &matrix) {
     ctmStack.push(topMatrix);
 }
 
+// Which GCanvasStats::ShaderType the shader is counted as, or -1 for no shader.
+static int shader_type(GShader *shader) {
+    if (!shader) {
+        return -1;
+    }
+    if (dynamic_cast<MyShader *>(shader)) {
+        return GCanvasStats::kBitmapShader;
+    }
+    if (dynamic_cast<LinearGradientShader *>(shader)) {
+        return GCanvasStats::kLinearGradientShader;
+    }
+    if (dynamic_cast<TriColorShader *>(shader)) {
+        return GCanvasStats::kTriColorShader;
+    }
+    if (dynamic_cast<ProxyShader *>(shader)) {
+        return GCanvasStats::kProxyShader;
+    }
+    if (dynamic_cast<CompositeShader *>(shader)) {
+        return GCanvasStats::kCompositeShader;
+    }
+    return GCanvasStats::kOtherShader;
+}
+
+GCanvasStats MyCanvas::stats() const {
+    return fStats.read();
+}
+
+void MyCanvas::resetStats() {
+    fStats.reset();
+}
+
+bool MyCanvas::getDamage(GRegion *damage) const {
+    *damage = fDamage;
+    return true;
+}
+
+void MyCanvas::resetDamage() {
+    fDamage.setEmpty();
+}
+
+// past this many rects the damage is kept as its bounds, so that adding to it stays cheap
+static const int kMaxDamageRects = 32;
+
+void MyCanvas::addDamage(const GRect &bounds) {
+    // clamp before rounding, so that huge (or NaN) coordinates become the clip's
+    const Clip &clip = *fClipStack.top();
+    const GIRect &clipBounds = clip.bounds();
+    GIRect r = GRect::LTRB(std::max((float)clipBounds.left, bounds.left), std::max((float)clipBounds.top, bounds.top),
+                           std::min((float)clipBounds.right, bounds.right), std::min((float)clipBounds.bottom, bounds.bottom))
+                   .roundOut();
+    if (r.isEmpty() || fDamage.contains(r)) {
+        return;
+    }
+    if (clip.isRect()) {
+        fDamage.op(r, GRegion::kUnion_Op);
+    } else {
+        GRegion clipped(r);
+        clipped.op(clip.region(), GRegion::kIntersect_Op);
+        fDamage.op(clipped, GRegion::kUnion_Op);
+    }
+    if (fDamage.countRects() > kMaxDamageRects) {
+        fDamage.setRect(fDamage.bounds());
+    }
+}
+
+template <typename Func>
+void drawRectTemplate(Func blendFunc, const GRect &rect, const GPaint &paint, GBitmap fDevice, const Clip &clip, LazyClear &lazy, const DrawCounters &counters);
+
 void MyCanvas::clear(const GColor &color) {
+    GTRACE_SCOPE("clear");
     GPixel pixel = ConvertColorToPixel(color);
 
-    for (int y = 0; y < fDevice.height(); y++) {
-        GPixel *addr = fDevice.getAddr(0, y);
-        std::fill(addr, addr + fDevice.width(), pixel);
+    int height = fDevice.height();
+    fStats.addDraw(GCanvasStats::kClear);
+
+    const Clip &clip = *fClipStack.top();
+    addDamage(GRect::WH(fDevice.width(), height));
+    if (!clip.contains(GIRect::WH(fDevice.width(), height))) {
+        // only what is inside the clip is cleared
+        DrawCounters counters = {&fStats, GBlendMode::kSrc, -1, fOverdraw};
+        drawRectTemplate(kSrc, GRect::WH(fDevice.width(), height), GPaint(color), fDevice, clip, fLazyClear, counters);
+        return;
+    }
+
+    fStats.addFillFastPath();
+    fStats.addRows(height, height, GBlendMode::kSrc, (uint64_t)height * fDevice.width());
+
+    // the pixels are written as draws reach them, or at flush()
+    fLazyClear.clear(pixel);
+    if (fOverdraw) {
+        for (int y = 0; y < height; y++) {
+            fOverdraw->addSpan(0, y, fDevice.width());
+        }
+    }
+}
+
+bool MyCanvas::quickReject(const GRect &bounds) {
+    const Clip &clip = *fClipStack.top();
+    const GIRect &clipBounds = clip.bounds();
+    // spans round their ends, so nothing at or beyond a side of the clip reaches a pixel inside it
+    if (clip.isEmpty() || bounds.right <= clipBounds.left || bounds.bottom <= clipBounds.top ||
+        bounds.left >= clipBounds.right || bounds.top >= clipBounds.bottom) {
+        fStats.addQuickReject();
+        return true;
+    }
+    return false;
+}
+
+void MyCanvas::clipRect(const GRect &rect) {
+    const GMatrix &ctm = ctmStack.top();
+    if (ctm[1] != 0 || ctm[2] != 0) {
+        // rotated or skewed, so no longer a device rect
+        GPath path;
+        path.addRect(rect);
+        clipPath(path);
+        return;
+    }
+
+    GIRect deviceRect = GIRect::LTRB(0, 0, 0, 0);
+    if (!rect.isEmpty()) {
+        GPoint corners[2] = {{rect.left, rect.top}, {rect.right, rect.bottom}};
+        ctm.mapPoints(corners, 2);
+        // the pixels whose centers are inside, as drawRect() fills them
+        deviceRect = GRect::LTRB(std::min(corners[0].x, corners[1].x), std::min(corners[0].y, corners[1].y),
+                                 std::max(corners[0].x, corners[1].x), std::max(corners[0].y, corners[1].y)).round();
+    }
+    fClipStack.top() = fClipStack.top()->intersect(deviceRect);
+}
+
+void MyCanvas::clipPath(const GPath &path) {
+    GTRACE_SCOPE("clipPath");
+    recycleArena();
+    const Clip &clip = *fClipStack.top();
+    if (clip.isEmpty()) {
+        return;
+    }
+
+    // scan converted once here; the runs are shared by every draw until restore()
+    EdgeList edges{GArenaAllocator<Edge>(&fArena)};
+    edges.reserve(path.countPoints() + 1);
+    processPath(path, ctmStack.top(), GIRect::WH(fDevice.width(), fDevice.height()), edges);
+    std::sort(edges.begin(), edges.end(), [](const Edge &edge1, const Edge &edge2) {
+        return edge1.top < edge2.top;
+    });
+    fClipStack.top() = clip.intersect(edges);
+}
+
+void MyCanvas::clipRegion(const GRegion &region) {
+    fClipStack.top() = fClipStack.top()->intersect(region);
+}
+
+// Pixel bounds of the spans a list of clipped edges can produce. Each edge is a line between its
+// first and last sample rows, so its x extremes are at those rows.
+template <typename EdgeIter>
+static GIRect edges_bounds(EdgeIter begin, EdgeIter end) {
+    float minX = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    int top = std::numeric_limits<int>::max();
+    int bottom = std::numeric_limits<int>::min();
+    for (EdgeIter edge = begin; edge != end; ++edge) {
+        if (edge->top >= edge->bottom) {
+            continue;
+        }
+        float x0 = edge->computeX(edge->top + 0.5f);
+        float x1 = edge->computeX(edge->bottom - 0.5f);
+        minX = std::min(minX, std::min(x0, x1));
+        maxX = std::max(maxX, std::max(x0, x1));
+        top = std::min(top, edge->top);
+        bottom = std::max(bottom, edge->bottom);
+    }
+    if (top >= bottom) {
+        return {0, 0, 0, 0};
+    }
+    // spans round their ends, so a pixel either side covers them
+    return GIRect::LTRB((int)std::floor(minX) - 1, top, (int)std::ceil(maxX) + 1, bottom);
+}
+
+static GIRect intersect(const GIRect &a, const GIRect &b) {
+    GIRect r = GIRect::LTRB(std::max(a.left, b.left), std::max(a.top, b.top),
+                            std::min(a.right, b.right), std::min(a.bottom, b.bottom));
+    return r.isEmpty() ? GIRect::LTRB(0, 0, 0, 0) : r;
+}
+
+// Blend a solid color into [L, R) of row y. In tiles that still held only the cleared color when
+// the draw began every pixel blends to the same value, known up front, so those are just filled.
+template <typename Func>
+static void blendSolidRow(Func blendFunc, GPixel *row, int L, int R, int y, GPixel srcPixel,
+                          const LazyClear &lazy, GPixel knownBlend) {
+    auto blendRange = [&](int x0, int x1) {
+        GPixel prevDst = row[x0];
+        GPixel prevBlend = blendFunc(prevDst, srcPixel);
+        for (int x = x0; x < x1; x++) {
+            if (row[x] != prevDst) {
+                prevDst = row[x];
+                prevBlend = blendFunc(prevDst, srcPixel);
+            }
+            row[x] = prevBlend;
+        }
+    };
+    if (!lazy.anyKnown()) {
+        blendRange(L, R);
+        return;
+    }
+    for (int x = L; x < R;) {
+        int tileEnd = std::min(R, ((x >> LazyClear::kTileShift) + 1) << LazyClear::kTileShift);
+        if (lazy.known(x, y)) {
+            std::fill(row + x, row + tileEnd, knownBlend);
+        } else {
+            blendRange(x, tileEnd);
+        }
+        x = tileEnd;
+    }
+}
+
+// Write the span [L, R) of row y: shade and blend it, or fill or blend the solid color.
+template <typename Func>
+static void blitSpan(Func blendFunc, const GBitmap &device, int L, int R, int y, GShader *shader,
+                     GPixel srcPixel, const LazyClear &lazy, GPixel knownBlend) {
+    GPixel *addr = device.getAddr(L, y);
+    if (shader) {
+        GPixel rowPixels[R - L];
+        {
+            GTRACE_SPAN_SCOPE("shadeRow");
+            shader->shadeRow(L, y, R - L, rowPixels);
+        }
+        GTRACE_SPAN_SCOPE("blend");
+        for (int i = 0; i < R - L; i++) {
+            addr[i] = blendFunc(addr[i], rowPixels[i]);
+        }
+    } else if (blendFunc == kSrc) {
+        std::fill(addr, addr + (R - L), srcPixel);
+    } else if (blendFunc == kClear) {
+        std::fill(addr, addr + (R - L), 0);
+    } else {
+        GTRACE_SPAN_SCOPE("blend");
+        blendSolidRow(blendFunc, device.getAddr(0, y), L, R, y, srcPixel, lazy, knownBlend);
     }
 }
 
 template <typename Func>
-void drawRectTemplate(Func blendFunc, const GRect &rect, const GPaint &paint, GBitmap fDevice) {  // making sure that rectangle is not out of bounds. CLAMPING
+void drawRectTemplate(Func blendFunc, const GRect &rect, const GPaint &paint, GBitmap fDevice, const Clip &clip, LazyClear &lazy, const DrawCounters &counters) {  // making sure that rectangle is not out of bounds. CLAMPING
     GIRect giRect = rect.round();
-    giRect.left = std::max(0, giRect.left);
-    giRect.top = std::max(0, giRect.top);
-    giRect.right = std::min(fDevice.width(), giRect.right);
-    giRect.bottom = std::min(fDevice.height(), giRect.bottom);
+    const GIRect &clipBounds = clip.bounds();
+    giRect.left = std::max(clipBounds.left, giRect.left);
+    giRect.top = std::max(clipBounds.top, giRect.top);
+    giRect.right = std::min(clipBounds.right, giRect.right);
+    giRect.bottom = std::min(clipBounds.bottom, giRect.bottom);
 
-    if (giRect.left >= fDevice.width() || giRect.top >= fDevice.height() || giRect.right <= 0 || giRect.bottom <= 0) {
+    if (giRect.isEmpty()) {
         return;
     }
 
@@ -53,68 +307,113 @@ void drawRectTemplate(Func blendFunc, const GRect &rect, const GPaint &paint, GB
 
     int count = giRect.width();
 
-    if (shader) {
-        if (blendFunc == kSrc) {
-            GPixel rowPixels[count];
-            for (int y = giRect.top; y < giRect.bottom; y++) {
-                shader->shadeRow(giRect.left, y, count, rowPixels);
-                for (int x = giRect.left; x < giRect.right; x++) {
-                    GPixel *addr = fDevice.getAddr(x, y);
-                    *addr = rowPixels[x - giRect.left];
-                }
+    lazy.prepare(giRect);
+    GPixel knownBlend = blendFunc(lazy.color(), srcPixel);
+
+    bool fills = blendFunc == kClear || (!shader && blendFunc == kSrc);
+    if (fills) {
+        counters.fStats->addFillFastPath();
+    } else if (shader) {
+        counters.fStats->noteScratch(count * sizeof(GPixel));
+    }
+
+    // every row is independent, so large rects are split across the shared pool
+    GParallelForRows(giRect.top, giRect.bottom, count, [&](int y0, int y1) {
+        GTRACE_SCOPE("scanlines");
+        if (!clip.isRect()) {
+            // each row is the pieces of the clip's runs inside the rect
+            uint64_t spans = 0;
+            uint64_t pixels = 0;
+            for (int y = y0; y < y1; y++) {
+                clip.forEachSpan(giRect.left, giRect.right, y, [&](int left, int right) {
+                    spans += 1;
+                    pixels += right - left;
+                    counters.addWrites(left, y, right - left);
+                    blitSpan(blendFunc, fDevice, left, right, y, shader, srcPixel, lazy, knownBlend);
+                });
             }
+            counters.addRows(y1 - y0, spans, pixels);
+            return;
         }
 
-        else if (blendFunc == kClear) {
-            for (int y = giRect.top; y < giRect.bottom; y++) {
-                GPixel *addr = fDevice.getAddr(giRect.left, y);
-                std::fill(addr, addr + count, 0);
+        if (shader) {
+            if (blendFunc == kSrc) {
+                GPixel rowPixels[count];
+                for (int y = y0; y < y1; y++) {
+                    {
+                        GTRACE_SPAN_SCOPE("shadeRow");
+                        shader->shadeRow(giRect.left, y, count, rowPixels);
+                    }
+                    GTRACE_SPAN_SCOPE("blend");
+                    for (int x = giRect.left; x < giRect.right; x++) {
+                        GPixel *addr = fDevice.getAddr(x, y);
+                        *addr = rowPixels[x - giRect.left];
+                    }
+                }
+            }
+
+            else if (blendFunc == kClear) {
+                for (int y = y0; y < y1; y++) {
+                    GPixel *addr = fDevice.getAddr(giRect.left, y);
+                    std::fill(addr, addr + count, 0);
+                }
+            }
+
+            else {
+                GPixel rowPixels[count];
+                for (int y = y0; y < y1; y++) {
+                    {
+                        GTRACE_SPAN_SCOPE("shadeRow");
+                        shader->shadeRow(giRect.left, y, count, rowPixels);
+                    }
+                    GTRACE_SPAN_SCOPE("blend");
+                    for (int x = giRect.left; x < giRect.right; x++) {
+                        GPixel *addr = fDevice.getAddr(x, y);
+                        *addr = blendFunc(*addr, rowPixels[x - giRect.left]);
+                    }
+                }
             }
         }
 
         else {
-            GPixel rowPixels[count];
-            for (int y = giRect.top; y < giRect.bottom; y++) {
-                shader->shadeRow(giRect.left, y, count, rowPixels);
-                for (int x = giRect.left; x < giRect.right; x++) {
-                    GPixel *addr = fDevice.getAddr(x, y);
-                    *addr = blendFunc(*addr, rowPixels[x - giRect.left]);
+            if (blendFunc == kSrc) {
+                for (int y = y0; y < y1; y++) {
+                    GPixel *addr = fDevice.getAddr(giRect.left, y);
+                    std::fill(addr, addr + count, srcPixel);
+                }
+            } else if (blendFunc == kClear) {
+                for (int y = y0; y < y1; y++) {
+                    GPixel *addr = fDevice.getAddr(giRect.left, y);
+                    std::fill(addr, addr + count, 0);
+                }
+            } else {
+                for (int y = y0; y < y1; y++) {
+                    GTRACE_SPAN_SCOPE("blend");
+                    blendSolidRow(blendFunc, fDevice.getAddr(0, y), giRect.left, giRect.right, y, srcPixel, lazy, knownBlend);
                 }
             }
         }
-    }
 
-    else {
-        if (blendFunc == kSrc) {
-            for (int y = giRect.top; y < giRect.bottom; y++) {
-                GPixel *addr = fDevice.getAddr(giRect.left, y);
-                std::fill(addr, addr + count, srcPixel);
-            }
-        } else if (blendFunc == kClear) {
-            for (int y = giRect.top; y < giRect.bottom; y++) {
-                GPixel *addr = fDevice.getAddr(giRect.left, y);
-                std::fill(addr, addr + count, 0);
-            }
+        for (int y = y0; y < y1; y++) {
+            counters.addWrites(giRect.left, y, count);
+        }
+
+        int rows = y1 - y0;
+        if (shader && blendFunc == kClear) {
+            // cleared without ever calling the shader
+            counters.fStats->addRows(rows, rows, counters.fMode, (uint64_t)rows * count);
         } else {
-            for (int y = giRect.top; y < giRect.bottom; y++) {
-                GPixel prevAddr = 1;
-                GPixel prevBlend;
-                for (int x = giRect.left; x < giRect.right; x++) {
-                    GPixel *addr = fDevice.getAddr(x, y);
-                    if (*addr == prevAddr) {
-                        *addr = prevBlend;
-                        continue;
-                    }
-                    prevAddr = *addr;
-                    prevBlend = blendFunc(*addr, srcPixel);
-                    *addr = prevBlend;
-                }
-            }
+            counters.addRows(rows, rows, (uint64_t)rows * count);
         }
-    }
+    });
 }
 
 void MyCanvas::drawRect(const GRect &rect, const GPaint &paint) {
+    GTRACE_SCOPE("drawRect");
+    fStats.addDraw(GCanvasStats::kRect);
+    AllocScope allocScope(&fStats, GCanvasStats::kRect);
+    recycleArena();
+
     GMatrix ctm = ctmStack.top();
     GPoint vertices[] = {
         {rect.left, rect.top},
@@ -124,12 +423,18 @@ void MyCanvas::drawRect(const GRect &rect, const GPaint &paint) {
 
     // if the ctm is only rotational, pass it to convex polygon
     if (ctm[1] != 0 || ctm[2] != 0) {
-        drawConvexPolygon(vertices, 4, paint);
+        fillConvexPolygon(vertices, 4, paint);
         return;
     }
 
     ctm.mapPoints(vertices, vertices, 4);
     GRect newRect = GRect::LTRB(vertices[0].x, vertices[0].y, vertices[2].x, vertices[2].y);
+    GRect bounds = GRect::LTRB(std::min(newRect.left, newRect.right), std::min(newRect.top, newRect.bottom),
+                               std::max(newRect.left, newRect.right), std::max(newRect.top, newRect.bottom));
+    if (quickReject(bounds)) {
+        return;
+    }
+    addDamage(bounds);
 
     if (paint.getShader() && !paint.getShader()->setContext(ctm)) {
         return;
@@ -143,78 +448,105 @@ void MyCanvas::drawRect(const GRect &rect, const GPaint &paint) {
     }
 
     if (blendmode == GBlendMode::kDst) {
+        fStats.addDstSkip();
         return;
     }
+    DrawCounters counters = {&fStats, blendmode, shader_type(paint.getShader()), fOverdraw};
 
     switch (blendmode) {
         case GBlendMode::kClear:
-            drawRectTemplate(kClear, newRect, paint, fDevice);
+            drawRectTemplate(kClear, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrc:
-            drawRectTemplate(kSrc, newRect, paint, fDevice);
+            drawRectTemplate(kSrc, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDst:
-            drawRectTemplate(kDst, newRect, paint, fDevice);
+            drawRectTemplate(kDst, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcOver:
-            drawRectTemplate(kSrcOver, newRect, paint, fDevice);
+            drawRectTemplate(kSrcOver, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcIn:
-            drawRectTemplate(kSrcIn, newRect, paint, fDevice);
+            drawRectTemplate(kSrcIn, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstOver:
-            drawRectTemplate(kDstOver, newRect, paint, fDevice);
+            drawRectTemplate(kDstOver, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstIn:
-            drawRectTemplate(kDstIn, newRect, paint, fDevice);
+            drawRectTemplate(kDstIn, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcOut:
-            drawRectTemplate(kSrcOut, newRect, paint, fDevice);
+            drawRectTemplate(kSrcOut, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstOut:
-            drawRectTemplate(kDstOut, newRect, paint, fDevice);
+            drawRectTemplate(kDstOut, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcATop:
-            drawRectTemplate(kSrcATop, newRect, paint, fDevice);
+            drawRectTemplate(kSrcATop, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstATop:
-            drawRectTemplate(kDstATop, newRect, paint, fDevice);
+            drawRectTemplate(kDstATop, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kXor:
-            drawRectTemplate(kXor, newRect, paint, fDevice);
+            drawRectTemplate(kXor, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
         default:
-            drawRectTemplate(kClear, newRect, paint, fDevice);
+            drawRectTemplate(kClear, newRect, paint, fDevice, *fClipStack.top(), fLazyClear, counters);
             break;
     }
 }
 
 template <typename Func>
-void drawConvexPolygonTemplate(Func blendFunc, const GPoint vertices[], int count, const GPaint &paint, const GBitmap fDevice) {
-    // bounds of the canvas
-    int canvasHeight = fDevice.height() - 1;
-    int canvasWidth = fDevice.width() - 1;
-
-    // create clipped edges at start
-    std::vector<Edge> edges = createEdges(vertices, count, canvasHeight, canvasWidth);
+void drawConvexPolygonTemplate(Func blendFunc, const GPoint vertices[], int count, const GPaint &paint, const GBitmap fDevice, GArena &arena, const Clip &clip, LazyClear &lazy, const DrawCounters &counters) {
+    // Polygons have always been clipped to the last row and column of pixel centers rather than
+    // the device's edges; keep that, so that unclipped output does not change.
+    GIRect deviceBounds = GIRect::WH(fDevice.width() - 1, fDevice.height() - 1);
+
+    // Edges are clipped to the device, never to the clip: moving an end point to a side of the
+    // clip shifts the rest of the edge by a rounding error, enough to move a span's end by a
+    // pixel. The clip only limits the rows scanned and the spans written.
+    int clipped = 0;
+    EdgeList edges{GArenaAllocator<Edge>(&arena)};
+    {
+        GTRACE_SCOPE("createEdges");
+        edges.reserve(count * 3);  // horizontal clipping can bend each side into 3 edges
+        createEdges(vertices, count, deviceBounds, edges, &clipped);
+    }
+    counters.fStats->addEdges(edges.size(), clipped);
 
     if (edges.size() < 2) {
         return;
     }
 
-    std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) {
-        if (a.top != b.top) return a.top < b.top;
-        return a.bottom < b.bottom; });
+    {
+        GTRACE_SCOPE("sort");
+        std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) {
+            if (a.top != b.top) return a.top < b.top;
+            return a.bottom < b.bottom; });
+    }
+    GTRACE_SCOPE("scanlines");
 
     GShader *shader = paint.getShader();
     GPixel srcPixel = ConvertColorToPixel(paint.getColor());
 
-    int y = edges[0].top;
+    const GIRect &clipBounds = clip.bounds();
+    lazy.prepare(intersect(edges_bounds(edges.begin(), edges.end()), clipBounds));
+    GPixel knownBlend = blendFunc(lazy.color(), srcPixel);
+
+    if (!shader && (blendFunc == kSrc || blendFunc == kClear)) {
+        counters.fStats->addFillFastPath();
+    }
+
+    int y = std::max(edges[0].top, clipBounds.top);
+    int firstY = y;
+    uint64_t spans = 0;
+    uint64_t pixels = 0;
+    int widestSpan = 0;
     int fpointer = 0;
     int spointer = 1;
     int temp = 2;
 
-    while (temp <= edges.size()) {
+    while (temp <= edges.size() && y < clipBounds.bottom) {
         Edge &edge1 = edges[fpointer];
         Edge &edge2 = edges[spointer];
         float center = y + 0.5;
@@ -241,57 +573,53 @@ void drawConvexPolygonTemplate(Func blendFunc, const GPoint vertices[], int coun
             std::swap(xIntercept1, xIntercept2);
         }
 
-        int startX = GRoundToInt(xIntercept1);
-        int endX = GRoundToInt(xIntercept2);
-        int span = endX - startX;
-        if (span != 0) {
-            if (shader) {
-                // new row pixels
-                GPixel rowPixels[span];
-                shader->shadeRow(startX, y, span, rowPixels);
-
-                for (int x = startX; x < endX; x++) {
-                    GPixel *addr = fDevice.getAddr(x, y);
-                    *addr = blendFunc(*addr, rowPixels[x - startX]);
-                }
-            } else {
-                if (blendFunc == kSrc) {
-                    GPixel *addr = fDevice.getAddr(startX, y);
-                    std::fill(addr, addr + (span), srcPixel);
-                }
-
-                else if (blendFunc == kClear) {
-                    GPixel *addr = fDevice.getAddr(startX, y);
-                    std::fill(addr, addr + (span), 0);
-                }
-
-                else {
-                    GPixel prevAddr = 1;
-                    GPixel prevBlend;
-                    for (int x = startX; x < endX; x++) {
-                        GPixel *addr = fDevice.getAddr(x, y);
-                        if (*addr == prevAddr) {
-                            *addr = prevBlend;
-                            continue;
-                        }
-                        prevAddr = *addr;
-                        prevBlend = blendFunc(*addr, srcPixel);
-                        *addr = prevBlend;
-                    }
-                }
-            }
-        }
+        int startX = std::max(GRoundToInt(xIntercept1), clipBounds.left);
+        int endX = std::min(GRoundToInt(xIntercept2), clipBounds.right);
+        clip.forEachSpan(startX, endX, y, [&](int left, int right) {
+            int span = right - left;
+            spans += 1;
+            pixels += span;
+            widestSpan = std::max(widestSpan, span);
+            counters.addWrites(left, y, span);
+            blitSpan(blendFunc, fDevice, left, right, y, shader, srcPixel, lazy, knownBlend);
+        });
         y++;
     }
+
+    counters.addRows(y - firstY, spans, pixels);
+    counters.fStats->noteScratch(edges.capacity() * sizeof(Edge) + (shader ? widestSpan * sizeof(GPixel) : 0));
 }
 
 void MyCanvas::drawConvexPolygon(const GPoint vertices[], int count, const GPaint &paint) {
+    GTRACE_SCOPE("drawConvexPolygon");
+    fStats.addDraw(GCanvasStats::kConvexPolygon);
+    AllocScope allocScope(&fStats, GCanvasStats::kConvexPolygon);
+    recycleArena();
+    fillConvexPolygon(vertices, count, paint);
+}
+
+void MyCanvas::fillConvexPolygon(const GPoint vertices[], int count, const GPaint &paint) {
     if (count < 3)
         return;
 
     GMatrix ctm = ctmStack.top();
     GPoint transformedVertices[count];
-    ctm.mapPoints(transformedVertices, vertices, count);
+    {
+        GTRACE_SCOPE("transform");
+        ctm.mapPoints(transformedVertices, vertices, count);
+    }
+
+    GRect bounds = GRect::LTRB(transformedVertices[0].x, transformedVertices[0].y, transformedVertices[0].x, transformedVertices[0].y);
+    for (int i = 1; i < count; i++) {
+        bounds.left = std::min(bounds.left, transformedVertices[i].x);
+        bounds.top = std::min(bounds.top, transformedVertices[i].y);
+        bounds.right = std::max(bounds.right, transformedVertices[i].x);
+        bounds.bottom = std::max(bounds.bottom, transformedVertices[i].y);
+    }
+    if (quickReject(bounds)) {
+        return;
+    }
+    addDamage(bounds);
 
     if (paint.getShader() && !paint.getShader()->setContext(ctm)) {
         return;
@@ -305,153 +633,250 @@ void MyCanvas::drawConvexPolygon(const GPoint vertices[], int count, const GPain
     }
 
     if (blendmode == GBlendMode::kDst) {
+        fStats.addDstSkip();
         return;
     }
+    DrawCounters counters = {&fStats, blendmode, shader_type(paint.getShader()), fOverdraw};
     switch (blendmode) {
         case GBlendMode::kClear:
-            drawConvexPolygonTemplate(kClear, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kClear, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrc:
-            drawConvexPolygonTemplate(kSrc, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kSrc, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDst:
-            drawConvexPolygonTemplate(kDst, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kDst, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcOver:
-            drawConvexPolygonTemplate(kSrcOver, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kSrcOver, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcIn:
-            drawConvexPolygonTemplate(kSrcIn, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kSrcIn, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstOver:
-            drawConvexPolygonTemplate(kDstOver, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kDstOver, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstIn:
-            drawConvexPolygonTemplate(kDstIn, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kDstIn, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcOut:
-            drawConvexPolygonTemplate(kSrcOut, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kSrcOut, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstOut:
-            drawConvexPolygonTemplate(kDstOut, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kDstOut, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcATop:
-            drawConvexPolygonTemplate(kSrcATop, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kSrcATop, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstATop:
-            drawConvexPolygonTemplate(kDstATop, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kDstATop, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kXor:
-            drawConvexPolygonTemplate(kXor, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kXor, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         default:
-            drawConvexPolygonTemplate(kSrcOver, transformedVertices, count, paint, fDevice);
+            drawConvexPolygonTemplate(kSrcOver, transformedVertices, count, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
     }
 }
 
-template <typename Func>
-void drawPathTemplate(Func blendFunc, const GPath &path, int count, const GPaint &paint, const GBitmap &fDevice) {
-    // GRect bounds = path.bounds();
-    // GIRect roundedBounds = bounds.round();
-
-    GRect bounds;
-    bounds.left = 0;
-    bounds.top = 0;
-    bounds.right = fDevice.width();
-    bounds.bottom = fDevice.height();
-    GIRect roundedBounds = bounds.round();
-
-    // make sure edges are clipped and processed correctly.
-    std::vector<Edge> pathEdges = processPath(path, fDevice);
+// paths with fewer edges than this are not worth splitting across threads
+static const size_t kParallelPathEdges = 4096;
+// smallest band of rows handed to a single task
+static const int kMinPathBandRows = 16;
 
-    if (pathEdges.size() < 2) {
-        return;
-    }
+// Scan-convert rows [y0, y1) of a path. sortedEdges must be sorted by top. Each band only touches
+// its own rows, so disjoint bands can be rasterized concurrently. Returns the bytes of scratch
+// memory the band used.
+template <typename Func>
+size_t drawPathBand(Func blendFunc, const EdgeList &sortedEdges, int y0, int y1, const GPaint &paint, const GBitmap &fDevice, const Clip &clip, const LazyClear &lazy, const DrawCounters &counters) {
+    // edges that start at or after y1 can never be active in this band
+    auto stop = std::lower_bound(sortedEdges.begin(), sortedEdges.end(), y1, [](const Edge &edge, int y) {
+        return edge.top < y;
+    });
+    // edges up to here have already started by y0
+    auto started = std::upper_bound(sortedEdges.begin(), stop, y0, [](int y, const Edge &edge) {
+        return y < edge.top;
+    });
 
-    std::sort(pathEdges.begin(), pathEdges.end(), [](Edge edge1, Edge edge2) {
-        if (edge1.top == edge2.top) {
-            return edge1.m * (edge1.top + .5) + edge1.b < edge2.m * (edge2.top + .5) + edge2.b;
+    // reused by every band this thread runs, so bands stop allocating once it has grown
+    static thread_local std::vector<Edge> activeEdges;
+    activeEdges.clear();
+    for (auto it = sortedEdges.begin(); it != started; ++it) {
+        if (it->bottom > y0) {
+            activeEdges.push_back(*it);
         }
-        return edge1.top < edge2.top;
-    });
+    }
+    auto next = started;
 
     GShader *shader = paint.getShader();
     GPixel srcPixel = ConvertColorToPixel(paint.getColor());
+    GPixel knownBlend = blendFunc(lazy.color(), srcPixel);
+    // most draws have a rect clip, whose spans need no cutting
+    const bool rectClip = clip.isRect();
+    const GIRect &clipBounds = clip.bounds();
+
+    uint64_t spans = 0;
+    uint64_t pixels = 0;
+    int widestSpan = 0;
+
+    GTRACE_SCOPE("scanlines");
+    int rows = 0;
+    for (int y = y0; y < y1; y++) {
+        if (activeEdges.empty()) {
+            if (next == stop) {
+                break;  // nothing left below this row
+            }
+            // skip the gap down to the next contour
+            y = std::max(y, next->top);
+        }
+        rows += 1;
+        float center = y + 0.5;
+
+        while (next != stop && next->top <= y) {
+            activeEdges.push_back(*next);
+            ++next;
+        }
+
+        std::sort(activeEdges.begin(), activeEdges.end(), [center](const Edge &a, const Edge &b) {
+            return a.computeX(center) < b.computeX(center);
+        });
 
-    for (int y = roundedBounds.top; y < roundedBounds.bottom; y++) {
-        size_t i = 0;
+        size_t kept = 0;
         int w = 0;
         int L = 0;
-        float center = y + 0.5;
 
-        while (i < pathEdges.size() && pathEdges[i].isValid(center)) {
-            int x = GRoundToInt(pathEdges[i].computeX(center));
+        for (size_t i = 0; i < activeEdges.size(); i++) {
+            int x = GRoundToInt(activeEdges[i].computeX(center));
             if (w == 0) {
                 L = x;
             }
-            w += pathEdges[i].winding_val;
+            w += activeEdges[i].winding_val;
             if (w == 0) {
                 int R = x;
 
-                // if (R < L) {
-                //     std::swap(L, R);
-                // }
                 assert(R >= L);
-                int span = R - L;
-                if (span != 0) {
-                    if (shader) {
-                        GPixel rowPixels[R - L];
-                        shader->shadeRow(L, y, R - L, rowPixels);
-                        for (int x = L; x < R; x++) {
-                            GPixel *addr = fDevice.getAddr(x, y);
-                            *addr = blendFunc(*addr, rowPixels[x - L]);
-                        }
-                    } else {
-                        if (blendFunc == kSrc) {
-                            GPixel *addr = fDevice.getAddr(L, y);
-                            std::fill(addr, addr + (R - L), srcPixel);
-                        } else if (blendFunc == kClear) {
-                            GPixel *addr = fDevice.getAddr(L, y);
-                            std::fill(addr, addr + (R - L), 0);
-                        }
-
-                        else {
-                            GPixel *addr = fDevice.getAddr(L, y);
-                            for (int x = L; x < R; x++) {
-                                *addr = blendFunc(*addr, srcPixel);
-                                addr++;
-                            }
-                        }
+                auto blit = [&](int left, int right) {
+                    int span = right - left;
+                    spans += 1;
+                    pixels += span;
+                    widestSpan = std::max(widestSpan, span);
+                    counters.addWrites(left, y, span);
+                    blitSpan(blendFunc, fDevice, left, right, y, shader, srcPixel, lazy, knownBlend);
+                };
+                L = std::max(L, clipBounds.left);
+                R = std::min(R, clipBounds.right);
+                if (rectClip) {
+                    if (R > L) {
+                        blit(L, R);
                     }
+                } else {
+                    clip.forEachSpan(L, R, y, blit);
                 }
             }
-            if (pathEdges[i].isValid(center + 1)) {
-                // pathEdges[i].currentX += pathEdges[i].m;
-                i++;
-            } else {
-                pathEdges.erase(pathEdges.begin() + i);
+            // drop edges that end on this row
+            if (activeEdges[i].isValid(center + 1)) {
+                activeEdges[kept++] = activeEdges[i];
             }
         }
 
         assert(w == 0);
+        activeEdges.erase(activeEdges.begin() + kept, activeEdges.end());
+    }
 
-        while (i < pathEdges.size() && pathEdges[i].isValid(center + 1)) {
-            i += 1;
-        }
+    counters.addRows(rows, spans, pixels);
+    return activeEdges.capacity() * sizeof(Edge) + (shader ? widestSpan * sizeof(GPixel) : 0);
+}
+
+// A rect containing the path once it is mapped by ctm: the corners of its control-point bounds,
+// mapped. Cheap, and an affine map keeps the path inside the mapped rect.
+static GRect device_bounds(const GPath &path, const GMatrix &ctm) {
+    GRect r = path.bounds(GPath::kControlPoints_BoundsType);
+    GPoint corners[4] = {{r.left, r.top}, {r.right, r.top}, {r.right, r.bottom}, {r.left, r.bottom}};
+    ctm.mapPoints(corners, 4);
+    GRect bounds = GRect::LTRB(corners[0].x, corners[0].y, corners[0].x, corners[0].y);
+    for (const GPoint &p : corners) {
+        bounds.left = std::min(bounds.left, p.x);
+        bounds.top = std::min(bounds.top, p.y);
+        bounds.right = std::max(bounds.right, p.x);
+        bounds.bottom = std::max(bounds.bottom, p.y);
+    }
+    return bounds;
+}
+
+template <typename Func>
+void drawPathTemplate(Func blendFunc, const GPath &path, const GMatrix &ctm, const GPaint &paint, const GBitmap &fDevice, GArena &arena, const Clip &clip, LazyClear &lazy, const DrawCounters &counters) {
+    // make sure edges are clipped and processed correctly.
+    int clipped = 0;
+    EdgeList pathEdges{GArenaAllocator<Edge>(&arena)};
+    {
+        GTRACE_SCOPE("processPath");
+        pathEdges.reserve(path.countPoints() + 1);
+        // to the device rather than the clip, as for polygons
+        processPath(path, ctm, GIRect::WH(fDevice.width(), fDevice.height()), pathEdges, &clipped);
+    }
+    counters.fStats->addEdges(pathEdges.size(), clipped);
 
-        std::sort(pathEdges.begin(), pathEdges.begin() + i, [center](const Edge &a, const Edge &b) {
-            return a.computeX(center + 1) < b.computeX(center + 1);
+    if (pathEdges.size() < 2) {
+        return;
+    }
+
+    {
+        GTRACE_SCOPE("sort");
+        std::sort(pathEdges.begin(), pathEdges.end(), [](const Edge &edge1, const Edge &edge2) {
+            return edge1.top < edge2.top;
         });
     }
+
+    // only the rows the edges span inside the clip are scanned
+    GIRect edgeBounds = intersect(edges_bounds(pathEdges.begin(), pathEdges.end()), clip.bounds());
+    if (edgeBounds.isEmpty()) {
+        return;
+    }
+    lazy.prepare(edgeBounds);
+
+    if (!paint.getShader() && (blendFunc == kSrc || blendFunc == kClear)) {
+        counters.fStats->addFillFastPath();
+    }
+    size_t edgeBytes = pathEdges.capacity() * sizeof(Edge);
+
+    int workers = GGetWorkerCount();
+    if (workers == 0 || pathEdges.size() < kParallelPathEdges) {
+        size_t bandBytes = drawPathBand(blendFunc, pathEdges, edgeBounds.top, edgeBounds.bottom, paint, fDevice, clip, lazy, counters);
+        counters.fStats->noteScratch(edgeBytes + bandBytes);
+        return;
+    }
+
+    // a few bands per thread so that stealing can even out uneven rows
+    int bandRows = std::max(kMinPathBandRows, edgeBounds.height() / ((workers + 1) * 4));
+    std::atomic<size_t> maxBandBytes(0);
+    GParallelFor(edgeBounds.top, edgeBounds.bottom, bandRows, [&](int y0, int y1) {
+        size_t bandBytes = drawPathBand(blendFunc, pathEdges, y0, y1, paint, fDevice, clip, lazy, counters);
+        size_t prev = maxBandBytes.load(std::memory_order_relaxed);
+        while (bandBytes > prev && !maxBandBytes.compare_exchange_weak(prev, bandBytes, std::memory_order_relaxed)) {
+        }
+    });
+    // every thread may be holding a band this size at once
+    counters.fStats->noteScratch(edgeBytes + maxBandBytes.load() * (workers + 1));
 }
 
 void MyCanvas::drawPath(const GPath &path, const GPaint &paint) {
-    GPath transformedPath = path;
-    int count = transformedPath.countPoints();
-    transformedPath.transform(ctmStack.top());
+    GTRACE_SCOPE("drawPath");
+    fStats.addDraw(GCanvasStats::kPath);
+    AllocScope allocScope(&fStats, GCanvasStats::kPath);
+    recycleArena();
+
+    // processPath maps the points by the CTM as it reads them
+    const GMatrix &ctm = ctmStack.top();
+
+    // paths entirely outside the clip never reach edge building
+    GRect bounds = device_bounds(path, ctm);
+    if (quickReject(bounds)) {
+        return;
+    }
+    addDamage(bounds);
 
-    if (paint.getShader() && !paint.getShader()->setContext(ctmStack.top())) {
+    if (paint.getShader() && !paint.getShader()->setContext(ctm)) {
         return;
     }
 
@@ -463,54 +888,65 @@ void MyCanvas::drawPath(const GPath &path, const GPaint &paint) {
     }
 
     if (blendmode == GBlendMode::kDst) {
+        fStats.addDstSkip();
         return;
     }
+    DrawCounters counters = {&fStats, blendmode, shader_type(paint.getShader()), fOverdraw};
 
     switch (blendmode) {
         case GBlendMode::kClear:
-            drawPathTemplate(kClear, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kClear, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrc:
-            drawPathTemplate(kSrc, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kSrc, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDst:
-            drawPathTemplate(kDst, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kDst, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcOver:
-            drawPathTemplate(kSrcOver, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kSrcOver, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcIn:
-            drawPathTemplate(kSrcIn, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kSrcIn, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstOver:
-            drawPathTemplate(kDstOver, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kDstOver, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstIn:
-            drawPathTemplate(kDstIn, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kDstIn, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcOut:
-            drawPathTemplate(kSrcOut, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kSrcOut, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstOut:
-            drawPathTemplate(kDstOut, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kDstOut, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kSrcATop:
-            drawPathTemplate(kSrcATop, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kSrcATop, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kDstATop:
-            drawPathTemplate(kDstATop, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kDstATop, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         case GBlendMode::kXor:
-            drawPathTemplate(kXor, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kXor, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
         default:
-            drawPathTemplate(kSrcOver, transformedPath, count, paint, fDevice);
+            drawPathTemplate(kSrcOver, path, ctm, paint, fDevice, fArena, *fClipStack.top(), fLazyClear, counters);
             break;
     }
 }
 
 void MyCanvas::drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
                         int count, const int indices[], const GPaint &paint) {
+    GTRACE_SCOPE("drawMesh");
+    fStats.addDraw(GCanvasStats::kMesh);
+    AllocScope allocScope(&fStats, GCanvasStats::kMesh);
+    recycleArena();
+    fillMesh(verts, colors, texs, count, indices, paint);
+}
+
+void MyCanvas::fillMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
+                        int count, const int indices[], const GPaint &paint) {
     GPoint p0, p1, p2, t0, t1, t2;
     GColor c0, c1, c2;
 
@@ -531,19 +967,19 @@ void MyCanvas::drawMesh(const GPoint verts[], const GColor colors[], const GPoin
             c0 = colors[i0];
             c1 = colors[i1];
             c2 = colors[i2];
-            TriColorShader *shaderT = new TriColorShader(p0, p1, p2, c0, c1, c2);
+            TriColorShader *shaderT = fArena.make<TriColorShader>(p0, p1, p2, c0, c1, c2);
 
             if (texs && paint.getShader() != nullptr) {
                 t0 = texs[i0];
                 t1 = texs[i1];
                 t2 = texs[i2];
-                ProxyShader *shaderP = new ProxyShader(p0, p1, p2, t0, t1, t2, paint.getShader());
-                CompositeShader *shaderC = new CompositeShader(shaderT, shaderP);
+                ProxyShader *shaderP = fArena.make<ProxyShader>(p0, p1, p2, t0, t1, t2, paint.getShader());
+                CompositeShader *shaderC = fArena.make<CompositeShader>(shaderT, shaderP);
                 GPaint paintC = GPaint(shaderC);
-                drawConvexPolygon(triVertices, 3, paintC);
+                fillConvexPolygon(triVertices, 3, paintC);
             } else {
                 GPaint paintT = GPaint(shaderT);
-                drawConvexPolygon(triVertices, 3, paintT);
+                fillConvexPolygon(triVertices, 3, paintT);
             }
 
         } else if (paint.getShader() != nullptr && texs) {
@@ -553,9 +989,9 @@ void MyCanvas::drawMesh(const GPoint verts[], const GColor colors[], const GPoin
             t2 = texs[i2];
 
             // implement ProxyShader
-            ProxyShader *shaderP = new ProxyShader(p0, p1, p2, t0, t1, t2, paint.getShader());
+            ProxyShader *shaderP = fArena.make<ProxyShader>(p0, p1, p2, t0, t1, t2, paint.getShader());
             GPaint paintP = GPaint(shaderP);
-            drawConvexPolygon(triVertices, 3, paintP);
+            fillConvexPolygon(triVertices, 3, paintP);
         }
         n += 3;
     }
@@ -567,6 +1003,11 @@ void MyCanvas::drawQuad(const GPoint verts[4], const GColor colors[4], const GPo
     GColor myColors[4];
     GPoint myTexs[4];
 
+    GTRACE_SCOPE("drawQuad");
+    fStats.addDraw(GCanvasStats::kQuad);
+    AllocScope allocScope(&fStats, GCanvasStats::kQuad);
+    recycleArena();
+
     int n = level + 1;
 
     int indices[6] = {0, 1, 2, 1, 3, 2};
@@ -599,7 +1040,7 @@ void MyCanvas::drawQuad(const GPoint verts[4], const GColor colors[4], const GPo
                 myColors[3] = bilerp(colors[0], colors[1], colors[2], colors[3], u + 1.0f / n, v + 1.0f / n);
                 cp = myColors;
             }
-            drawMesh(myVerts, cp, tp, 2, indices, paint);
+            fillMesh(myVerts, cp, tp, 2, indices, paint);
         }
     }
 }
@@ -0,0 +1,72 @@
+#include <algorithm>
+
+#include "_clip.h"
+
+std::shared_ptr<const Clip> Clip::intersect(const GIRect &r) const {
+    GRegion region = fRegion;
+    region.op(r, GRegion::kIntersect_Op);
+    return std::make_shared<const Clip>(std::move(region));
+}
+
+std::shared_ptr<const Clip> Clip::intersect(const GRegion &other) const {
+    GRegion region = fRegion;
+    region.op(other, GRegion::kIntersect_Op);
+    return std::make_shared<const Clip>(std::move(region));
+}
+
+std::shared_ptr<const Clip> Clip::intersect(const EdgeList &sortedEdges) const {
+    GRegion::Builder builder;
+    if (sortedEdges.empty() || this->isEmpty()) {
+        return std::make_shared<const Clip>(builder.detach());
+    }
+
+    // the same scan conversion drawPath uses, but keeping the spans instead of filling them
+    const GIRect &bounds = this->bounds();
+    const int top = std::max(bounds.top, sortedEdges.front().top);
+    int bottom = top;
+    for (const Edge &edge : sortedEdges) {
+        bottom = std::max(bottom, edge.bottom);
+    }
+    bottom = std::min(bottom, bounds.bottom);
+
+    std::vector<Edge> activeEdges;
+    std::vector<GRegion::Span> row;
+    auto next = sortedEdges.begin();
+    for (int y = top; y < bottom; y++) {
+        float center = y + 0.5f;
+
+        while (next != sortedEdges.end() && next->top <= y) {
+            if (next->bottom > y) {
+                activeEdges.push_back(*next);
+            }
+            ++next;
+        }
+        std::sort(activeEdges.begin(), activeEdges.end(), [center](const Edge &a, const Edge &b) {
+            return a.computeX(center) < b.computeX(center);
+        });
+
+        row.clear();
+        size_t kept = 0;
+        int w = 0;
+        int L = 0;
+        for (size_t i = 0; i < activeEdges.size(); i++) {
+            int x = GRoundToInt(activeEdges[i].computeX(center));
+            if (w == 0) {
+                L = x;
+            }
+            w += activeEdges[i].winding_val;
+            if (w == 0 && std::min(x, bounds.right) > std::max(L, bounds.left)) {
+                // cut against this clip
+                this->forEachSpan(std::max(L, bounds.left), std::min(x, bounds.right), y, [&](int left, int right) {
+                    row.push_back({left, right});
+                });
+            }
+            if (activeEdges[i].isValid(center + 1)) {
+                activeEdges[kept++] = activeEdges[i];
+            }
+        }
+        activeEdges.erase(activeEdges.begin() + kept, activeEdges.end());
+        builder.addRow(y, row.data(), (int)row.size());
+    }
+    return std::make_shared<const Clip>(builder.detach());
+}
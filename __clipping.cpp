@@ -21,7 +21,7 @@ bool verticalClipping(GPoint &p1, GPoint &p2, int top, int bottom) {
     return true;
 }
 
-std::vector<GPoint> horizontalClipping(GPoint &p1, GPoint &p2, int left, int right) {
+int horizontalClipping(GPoint &p1, GPoint &p2, int left, int right, GPoint pts[4]) {
     if (p1.x > p2.x) {
         std::swap(p1, p2);
     }
@@ -33,22 +33,26 @@ std::vector<GPoint> horizontalClipping(GPoint &p1, GPoint &p2, int left, int rig
         // p2.y and p1.y is same, the x value changes to 0 (start of canvas)
         p1.x = left;
         p2.x = left;
-        return {p1, p2};
+        pts[0] = p1;
+        pts[1] = p2;
+        return 2;
     }
 
     if (p1.x > right) {
         p1.x = right;  // change the x to max width
         p2.x = right;
-        return {p1, p2};
+        pts[0] = p1;
+        pts[1] = p2;
+        return 2;
     }
 
-    std::vector<GPoint> pts;
+    int n = 0;
 
     if (p1.x < left) {
         // bend -> compute + project
         //  find intersection using similar triangles
         GPoint bendLeft = {left, p1.y};
-        pts.push_back(bendLeft);
+        pts[n++] = bendLeft;
         p1.y += m * (left - p1.x);
         p1.x = left;
     }
@@ -56,18 +60,17 @@ std::vector<GPoint> horizontalClipping(GPoint &p1, GPoint &p2, int left, int rig
     if (p2.x > right) {
         // bend -> compute + project
         GPoint bendRight = {right, p2.y};
-        pts.push_back(bendRight);
+        pts[n++] = bendRight;
         p2.y += m * (right - p2.x);
         p2.x = right;
     }
 
-    pts.push_back(p1);
-    pts.push_back(p2);
-    return pts;
+    pts[n++] = p1;
+    pts[n++] = p2;
+    return n;
 }
 
-std::vector<Edge> createEdges(const GPoint vertices[], int count, int maxHeight, int maxWidth) {
-    std::vector<Edge> edges;
+void createEdges(const GPoint vertices[], int count, const GIRect &clip, EdgeList &edges, int *clipped) {
     for (int i = 0; i < count; i++) {
         GPoint p1 = vertices[i];
         GPoint p2 = vertices[(i + 1) % count];
@@ -79,22 +82,25 @@ std::vector<Edge> createEdges(const GPoint vertices[], int count, int maxHeight,
             std::swap(p1, p2);
         }
 
-        if (!verticalClipping(p1, p2, 0, maxHeight))
+        if (!verticalClipping(p1, p2, clip.top, clip.bottom)) {
+            if (clipped) {
+                (*clipped)++;
+            }
             continue;
+        }
 
-        auto clippedPts = horizontalClipping(p1, p2, 0, maxWidth);
+        GPoint clippedPts[4];
+        int n = horizontalClipping(p1, p2, clip.left, clip.right, clippedPts);
 
-        std::sort(clippedPts.begin(), clippedPts.end(), [](const GPoint &a, const GPoint &b) { return a.y > b.y; });
+        std::sort(clippedPts, clippedPts + n, [](const GPoint &a, const GPoint &b) { return a.y > b.y; });
 
-        for (size_t j = 0; j + 1 < clippedPts.size(); j++) {
+        for (int j = 0; j + 1 < n; j++) {
             edges.push_back(Edge(clippedPts[j], clippedPts[j + 1], 1));
         }
     }
-    return edges;
 }
 
-std::vector<Edge> createPathEdges(GPoint p0, GPoint p1, int bottom, int right) {
-    std::vector<Edge> windedEdges;
+void createPathEdges(GPoint p0, GPoint p1, const GIRect &clip, EdgeList &edges, int *clipped) {
     int winding = 1;
 
     if (p0.y > p1.y) {
@@ -103,35 +109,34 @@ std::vector<Edge> createPathEdges(GPoint p0, GPoint p1, int bottom, int right) {
     }
 
     // Apply vertical clipping
-    if (!verticalClipping(p0, p1, 0, bottom)) {
+    if (!verticalClipping(p0, p1, clip.top, clip.bottom)) {
         // Edge is completely out of vertical bounds
-        return windedEdges;
+        if (clipped) {
+            (*clipped)++;
+        }
+        return;
     }
 
     // Apply horizontal clipping
-    auto clippedPts = horizontalClipping(p0, p1, 0, right);
+    GPoint clippedPts[4];
+    int n = horizontalClipping(p0, p1, clip.left, clip.right, clippedPts);
 
-    std::sort(clippedPts.begin(), clippedPts.end(), [](const GPoint &a, const GPoint &b) { return a.y > b.y; });
+    std::sort(clippedPts, clippedPts + n, [](const GPoint &a, const GPoint &b) { return a.y > b.y; });
 
     // In case horizontal clipping introduces bends, create edges for each segment
-    for (size_t i = 0; i + 1 < clippedPts.size(); ++i) {
+    for (int i = 0; i + 1 < n; ++i) {
         GPoint start = clippedPts[i];
         GPoint end = clippedPts[i + 1];
         Edge e = Edge(start, end, winding);
 
         // Check for horizontal edges, which we can ignore in non-zero winding rule
         if (e.top != e.bottom) {
-            windedEdges.push_back(e);
+            edges.push_back(e);
         }
     }
-
-    return windedEdges;
 }
 
-std::vector<Edge> processPath(const GPath &path, const GBitmap &fDevice) {
-    std::vector<Edge> edges;
-    // GRect bounds = GRect::WH(fDevice.width(), fDevice.height());
-
+void processPath(const GPath &path, const GMatrix &ctm, const GIRect &clip, EdgeList &edges, int *clipped) {
     GPath::Edger edger(path);
     GPoint pts[GPath::kMaxNextPoints];
     std::optional<GPath::Verb> verbOpt;
@@ -139,10 +144,10 @@ std::vector<Edge> processPath(const GPath &path, const GBitmap &fDevice) {
 
     while ((verbOpt = edger.next(pts))) {
         GPath::Verb verb = *verbOpt;  // dereference the optional
+        ctm.mapPoints(pts, pts, verb == GPath::kLine ? 2 : verb == GPath::kQuad ? 3 : 4);
 
         if (verb == GPath::kLine) {
-            auto pathEdges = createPathEdges(pts[0], pts[1], fDevice.height(), fDevice.width());
-            edges.insert(edges.end(), pathEdges.begin(), pathEdges.end());
+            createPathEdges(pts[0], pts[1], clip, edges, clipped);
         }
 
         if (verb == GPath::kQuad) {
@@ -156,14 +161,12 @@ std::vector<Edge> processPath(const GPath &path, const GBitmap &fDevice) {
             for (float t = dt; t < 1; t += dt) {
                 GPoint newPt = ((1 - t) * (1 - t) * pts[0]) + (2 * t * (1 - t) * pts[1]) + (t * t * pts[2]);
                 clippedPt2 = newPt;
-                auto pathEdges = createPathEdges(clippedPt1, clippedPt2, fDevice.height(), fDevice.width());
-                edges.insert(edges.end(), pathEdges.begin(), pathEdges.end());
+                createPathEdges(clippedPt1, clippedPt2, clip, edges, clipped);
                 clippedPt1 = clippedPt2;
             }
 
             clippedPt2 = pts[2];  // last point
-            auto pathEdges = createPathEdges(clippedPt1, clippedPt2, fDevice.height(), fDevice.width());
-            edges.insert(edges.end(), pathEdges.begin(), pathEdges.end());
+            createPathEdges(clippedPt1, clippedPt2, clip, edges, clipped);
         }
 
         if (verb == GPath::kCubic) {
@@ -180,14 +183,11 @@ std::vector<Edge> processPath(const GPath &path, const GBitmap &fDevice) {
             for (float t = dt; t < 1; t += dt) {
                 GPoint newPt = (1 - t) * (1 - t) * (1 - t) * pts[0] + 3 * t * (1 - t) * (1 - t) * pts[1] + 3 * t * t * (1 - t) * pts[2] + t * t * t * pts[3];
                 clippedPt2 = newPt;
-                auto pathEdges = createPathEdges(clippedPt1, clippedPt2, fDevice.height(), fDevice.width());
-                edges.insert(edges.end(), pathEdges.begin(), pathEdges.end());
+                createPathEdges(clippedPt1, clippedPt2, clip, edges, clipped);
                 clippedPt1 = clippedPt2;
             }
             clippedPt2 = pts[3];  // last point
-            auto pathEdges = createPathEdges(clippedPt1, clippedPt2, fDevice.height(), fDevice.width());
-            edges.insert(edges.end(), pathEdges.begin(), pathEdges.end());
+            createPathEdges(clippedPt1, clippedPt2, clip, edges, clipped);
         }
     }
-    return edges;
 }
@@ -9,6 +9,13 @@ std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap &bitmap) {
     return std::unique_ptr<GCanvas>(new MyCanvas(bitmap));
 }
 
+std::unique_ptr<GCanvas> GCreateDeferredCanvas(const GBitmap &bitmap) {
+    if (bitmap.width() <= 0 || bitmap.height() <= 0) {
+        return nullptr;
+    }
+    return std::unique_ptr<GCanvas>(new MyCanvas(bitmap, true));
+}
+
 std::string GDrawSomething(GCanvas *canvas, GISize dimension) {
     // draw a rectangle with a radial gradient
 
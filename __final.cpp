@@ -47,12 +47,12 @@ class LinearPositionGradient : public GShader {
         float prop = 0;
         float a, r, g, b;  // color components
 
-        p.x = x + 0.5f;
-        p.y = y + 0.5f;
-        p = fInverse * p;
+        // each pixel mapped on its own, so a span's pixels do not depend on where it starts
+        p.x = fInverse[2] * (y + 0.5f) + fInverse[4];
+        const float left = x + 0.5f;
 
         for (int i = 0; i < count; i++) {
-            float fx = p.x;
+            float fx = p.x + fInverse[0] * (left + i);
             if (fx < 0) {
                 fx = 0;
             } else if (fx >= 1) {
@@ -74,7 +74,6 @@ class LinearPositionGradient : public GShader {
             b = c0.b * (1 - prop) + c1.b * prop;
 
             row[i] = ConvertColorToPixel(GColor::RGBA(a, r, g, b));
-            p.x += fInverse[0];
         }
     }
 
@@ -68,18 +68,18 @@ void LinearGradientShader::shadeRow(int x, int y, int count, GPixel row[]) {
             row[i] = ConvertColorToPixel(GColor::RGBA(r, g, b, a));
         }
     } else if (fCount == 2) {
-        GPoint p;
         GColor c0 = fColors[0];
         GColor c1 = fColors[1];
         float prop = 0;
         float a, r, g, b;
 
-        p.x = x + 0.5f;
-        p.y = y + 0.5f;
-        p = fInverse * p;
+        // each pixel's x is mapped on its own, never stepped from the last, so a span gets the
+        // same pixels wherever it starts (e.g. where a clip cuts it)
+        const float rowX = fInverse[2] * (y + 0.5f) + fInverse[4];
+        const float left = x + 0.5f;
 
         for (int i = 0; i < count; i++) {
-            float x = p.x;
+            float x = rowX + fInverse[0] * (left + i);
 
             switch (fMode) {
                 case GTileMode::kClamp:
@@ -107,23 +107,20 @@ void LinearGradientShader::shadeRow(int x, int y, int count, GPixel row[]) {
             g = c0.g * (1 - prop) + c1.g * prop;
             b = c0.b * (1 - prop) + c1.b * prop;
             row[i] = ConvertColorToPixel(GColor::RGBA(r, g, b, a));
-            p.x += fInverse[0];
-            p.y += fInverse[3];
         }
     }
 
     else {
-        GPoint p;
         GColor c0, c1;  // colors to be lerped
         float prop = 0;
         float a, r, g, b;  // color components
 
-        p.x = x + 0.5f;
-        p.y = y + 0.5f;
-        p = fInverse * p;
+        // mapped per pixel, as above
+        const float rowX = fInverse[2] * (y + 0.5f) + fInverse[4];
+        const float left = x + 0.5f;
 
         for (int i = 0; i < count; i++) {
-            float x = p.x;
+            float x = rowX + fInverse[0] * (left + i);
 
             switch (fMode) {
                 case GTileMode::kClamp:
@@ -155,8 +152,6 @@ void LinearGradientShader::shadeRow(int x, int y, int count, GPixel row[]) {
             g = c0.g * (1 - prop) + c1.g * prop;
             b = c0.b * (1 - prop) + c1.b * prop;
             row[i] = ConvertColorToPixel(GColor::RGBA(r, g, b, a));
-            p.x += fInverse[0];
-            p.y += fInverse[3];
         }
     }
 }
@@ -0,0 +1,97 @@
+#include <algorithm>
+
+#include "_lazyClear.h"
+#include "include/GScheduler.h"
+#include "include/GTrace.h"
+
+LazyClear::LazyClear(const GBitmap &device, bool defer)
+    : fDevice(device),
+      fDefer(defer),
+      fColumns((device.width() + kTileSize - 1) >> kTileShift),
+      fRows((device.height() + kTileSize - 1) >> kTileShift),
+      fState(fColumns * fRows, kWritten) {}
+
+void LazyClear::clear(GPixel color) {
+    for (int index : fKnown) {
+        fState[index] = kWritten;
+    }
+    fKnown.clear();
+    std::fill(fState.begin(), fState.end(), kPending);
+    fPendingCount = (int)fState.size();
+    fColor = color;
+    if (!fDefer) {
+        this->resolve();
+    }
+}
+
+void LazyClear::prepare(GIRect bounds) {
+    // what the last draw knew is stale now
+    for (int index : fKnown) {
+        fState[index] = kWritten;
+    }
+    fKnown.clear();
+
+    bounds.left = std::max(bounds.left, 0);
+    bounds.top = std::max(bounds.top, 0);
+    bounds.right = std::min(bounds.right, fDevice.width());
+    bounds.bottom = std::min(bounds.bottom, fDevice.height());
+    if (fPendingCount == 0 || bounds.isEmpty()) {
+        return;
+    }
+
+    const int left = bounds.left >> kTileShift;
+    const int top = bounds.top >> kTileShift;
+    const int right = ((bounds.right - 1) >> kTileShift) + 1;
+    const int bottom = ((bounds.bottom - 1) >> kTileShift) + 1;
+    this->fillPending(left, top, right, bottom);
+
+    for (int ty = top; ty < bottom; ty++) {
+        for (int tx = left; tx < right; tx++) {
+            int index = ty * fColumns + tx;
+            if (fState[index] == kPending) {
+                fState[index] = kKnown;
+                fKnown.push_back(index);
+                fPendingCount -= 1;
+            }
+        }
+    }
+}
+
+void LazyClear::resolve() {
+    for (int index : fKnown) {
+        fState[index] = kWritten;
+    }
+    fKnown.clear();
+    if (fPendingCount == 0) {
+        return;
+    }
+    GTRACE_SCOPE("resolveClear");
+    this->fillPending(0, 0, fColumns, fRows);
+    std::fill(fState.begin(), fState.end(), kWritten);
+    fPendingCount = 0;
+}
+
+void LazyClear::fillPending(int left, int top, int right, int bottom) {
+    const int y0 = top << kTileShift;
+    const int y1 = std::min(bottom << kTileShift, fDevice.height());
+    const int x1 = std::min(right << kTileShift, fDevice.width());
+    GParallelForRows(y0, y1, x1 - (left << kTileShift), [&](int rowStart, int rowStop) {
+        for (int y = rowStart; y < rowStop; y++) {
+            const State *states = &fState[(y >> kTileShift) * fColumns];
+            GPixel *row = fDevice.getAddr(0, y);
+            // one fill per run of adjacent pending tiles
+            for (int tx = left; tx < right;) {
+                if (states[tx] != kPending) {
+                    tx++;
+                    continue;
+                }
+                int end = tx + 1;
+                while (end < right && states[end] == kPending) {
+                    end++;
+                }
+                std::fill(row + (tx << kTileShift), row + std::min(end << kTileShift, x1), fColor);
+                tx = end;
+            }
+        }
+    });
+}
@@ -0,0 +1,107 @@
+#include "_canvas.h"
+#include "include/GOverdrawCanvas.h"
+#include "include/GOwnedBitmap.h"
+
+// Forwards every call to a MyCanvas that counts its writes into fCounts.
+class OverdrawCanvas : public GOverdrawCanvas {
+   public:
+    OverdrawCanvas(const GBitmap &device) : fCanvas(device), fCounts(device.width(), device.height()) {
+        fCanvas.setOverdrawCounts(&fCounts);
+    }
+
+    void save() override { fCanvas.save(); }
+    void restore() override { fCanvas.restore(); }
+    void concat(const GMatrix &matrix) override { fCanvas.concat(matrix); }
+    void clipRect(const GRect &rect) override { fCanvas.clipRect(rect); }
+    void clipPath(const GPath &path) override { fCanvas.clipPath(path); }
+    void clipRegion(const GRegion &region) override { fCanvas.clipRegion(region); }
+    void clear(const GColor &color) override { fCanvas.clear(color); }
+    void drawRect(const GRect &rect, const GPaint &paint) override { fCanvas.drawRect(rect, paint); }
+
+    void drawConvexPolygon(const GPoint vertices[], int count, const GPaint &paint) override {
+        fCanvas.drawConvexPolygon(vertices, count, paint);
+    }
+
+    void drawPath(const GPath &path, const GPaint &paint) override { fCanvas.drawPath(path, paint); }
+
+    void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
+                  int count, const int indices[], const GPaint &paint) override {
+        fCanvas.drawMesh(verts, colors, texs, count, indices, paint);
+    }
+
+    void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+                  int level, const GPaint &paint) override {
+        fCanvas.drawQuad(verts, colors, texs, level, paint);
+    }
+
+    GCanvasStats stats() const override { return fCanvas.stats(); }
+    void resetStats() override { fCanvas.resetStats(); }
+    void flush() override { fCanvas.flush(); }
+    bool getDamage(GRegion *damage) const override { return fCanvas.getDamage(damage); }
+    void resetDamage() override { fCanvas.resetDamage(); }
+
+    const uint16_t *counts() const override { return fCounts.counts(); }
+
+    double overdrawRatio() const override {
+        const size_t pixels = (size_t)fCounts.width() * fCounts.height();
+        uint64_t writes = 0;
+        for (size_t i = 0; i < pixels; i++) {
+            writes += fCounts.counts()[i];
+        }
+        return (double)writes / pixels;
+    }
+
+    void histogram(uint64_t histogram[], int n) const override {
+        std::fill(histogram, histogram + n, 0);
+        const size_t pixels = (size_t)fCounts.width() * fCounts.height();
+        for (size_t i = 0; i < pixels; i++) {
+            histogram[std::min<int>(fCounts.counts()[i], n - 1)] += 1;
+        }
+    }
+
+    bool writeHeatmap(const char path[]) const override;
+
+    void resetCounts() override { fCounts.reset(); }
+
+   private:
+    MyCanvas fCanvas;
+    OverdrawCounts fCounts;
+};
+
+// the usual overdraw debugging colors
+static GPixel heat_color(int count) {
+    switch (count) {
+        case 0:
+            return GPixel_PackARGB(0xFF, 0x00, 0x00, 0x00);
+        case 1:
+            return GPixel_PackARGB(0xFF, 0x30, 0x60, 0xFF);
+        case 2:
+            return GPixel_PackARGB(0xFF, 0x40, 0xC0, 0x40);
+        case 3:
+            return GPixel_PackARGB(0xFF, 0xFF, 0x80, 0xC0);
+        default: {
+            // 4 is bright red, fading to deep red at 8+
+            int t = std::min(count, 8) - 4;
+            return GPixel_PackARGB(0xFF, 0xFF - t * 0x18, 0x30 - t * 0x0C, 0x30 - t * 0x0C);
+        }
+    }
+}
+
+bool OverdrawCanvas::writeHeatmap(const char path[]) const {
+    GOwnedBitmap heat(fCounts.width(), fCounts.height(), GOwnedBitmap::kUninitialized_Init);
+    for (int y = 0; y < heat.height(); y++) {
+        const uint16_t *row = fCounts.counts() + (size_t)y * fCounts.width();
+        GPixel *dst = heat.bitmap().getAddr(0, y);
+        for (int x = 0; x < heat.width(); x++) {
+            dst[x] = heat_color(row[x]);
+        }
+    }
+    return heat.bitmap().writeToFile(path);
+}
+
+std::unique_ptr<GOverdrawCanvas> GCreateOverdrawCanvas(const GBitmap &bitmap) {
+    if (bitmap.width() <= 0 || bitmap.height() <= 0) {
+        return nullptr;
+    }
+    return std::unique_ptr<GOverdrawCanvas>(new OverdrawCanvas(bitmap));
+}
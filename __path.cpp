@@ -60,22 +60,24 @@ void GPath::addCircle(GPoint center, float radius, Direction dir) {
     }
 }
 void GPath::transform(const GMatrix& m) {
-    int numfPts = countPoints();
-    GPoint* dst = new GPoint[numfPts];
-    m.mapPoints(dst, fPts.data(), numfPts);
-
-    // clear the fPts vector to repopulate it with the transformed points in dst
-    fPts.clear();
-    for (int i = 0; i < numfPts; i++) {
-        fPts.push_back(dst[i]);
-    }
-
-    delete[] dst;  // cleanup
+    // mapPoints reads each point before writing it, so it can map in place
+    m.mapPoints(fPts.data(), fPts.data(), countPoints());
 }
 
-GRect GPath::bounds() const {
+GRect GPath::bounds(BoundsType type) const {
     if (fPts.empty()) return GRect::WH(0, 0);
 
+    if (type == kControlPoints_BoundsType) {
+        GRect r = GRect::LTRB(fPts[0].x, fPts[0].y, fPts[0].x, fPts[0].y);
+        for (const GPoint& p : fPts) {
+            r.left = std::min(r.left, p.x);
+            r.top = std::min(r.top, p.y);
+            r.right = std::max(r.right, p.x);
+            r.bottom = std::max(r.bottom, p.y);
+        }
+        return r;
+    }
+
     // Instantiate minX, minY, maxX, maxY to the first point
     float minX = fPts[0].x;
     float minY = fPts[0].y;
@@ -0,0 +1,93 @@
+#include <algorithm>
+
+#include "_allocs.h"
+#include "_stats.h"
+#include "include/GScheduler.h"
+
+CanvasStats::CanvasStats() : fSlotCount(1 + GGetWorkerCount()), fSlots(new Slot[fSlotCount]) {
+    reset();
+}
+
+CanvasStats::~CanvasStats() {
+    ForgetAllocs(this);
+}
+
+CanvasStats::Slot &CanvasStats::local() {
+    // callers outside the pool get -1, i.e. slot 0
+    int index = GGetWorkerIndex() + 1;
+    return fSlots[index < fSlotCount ? index : 0];
+}
+
+void CanvasStats::addEdges(uint64_t built, uint64_t clipped) {
+    Slot &slot = local();
+    add(slot, slot.fEdgesBuilt, built);
+    add(slot, slot.fEdgesClipped, clipped);
+}
+
+void CanvasStats::addRows(uint64_t scanlines, uint64_t spans, GBlendMode mode, uint64_t pixels) {
+    Slot &slot = local();
+    add(slot, slot.fScanlines, scanlines);
+    add(slot, slot.fSpans, spans);
+    add(slot, slot.fBlendedPixels[(int)mode], pixels);
+}
+
+void CanvasStats::addShaded(int shaderType, uint64_t calls, uint64_t pixels) {
+    Slot &slot = local();
+    add(slot, slot.fShadeRowCalls[shaderType], calls);
+    add(slot, slot.fShadedPixels[shaderType], pixels);
+}
+
+void CanvasStats::noteScratch(uint64_t bytes) {
+    Counter &peak = local().fScratchBytesPeak;
+    uint64_t seen = peak.load(std::memory_order_relaxed);
+    while (bytes > seen && !peak.compare_exchange_weak(seen, bytes, std::memory_order_relaxed)) {
+    }
+}
+
+GCanvasStats CanvasStats::read() const {
+    GCanvasStats stats = GCanvasStats();
+    auto sum = [](uint64_t &total, const Counter &counter) {
+        total += counter.load(std::memory_order_relaxed);
+    };
+
+    for (int s = 0; s < fSlotCount; s++) {
+        const Slot &slot = fSlots[s];
+        for (int i = 0; i < GCanvasStats::kPrimitiveCount; i++) {
+            sum(stats.fDraws[i], slot.fDraws[i]);
+        }
+        sum(stats.fEdgesBuilt, slot.fEdgesBuilt);
+        sum(stats.fEdgesClipped, slot.fEdgesClipped);
+        sum(stats.fScanlines, slot.fScanlines);
+        sum(stats.fSpans, slot.fSpans);
+        for (int i = 0; i < GCanvasStats::kBlendModeCount; i++) {
+            sum(stats.fBlendedPixels[i], slot.fBlendedPixels[i]);
+        }
+        for (int i = 0; i < GCanvasStats::kShaderTypeCount; i++) {
+            sum(stats.fShadeRowCalls[i], slot.fShadeRowCalls[i]);
+            sum(stats.fShadedPixels[i], slot.fShadedPixels[i]);
+        }
+        sum(stats.fFillFastPath, slot.fFillFastPath);
+        sum(stats.fDstSkips, slot.fDstSkips);
+        sum(stats.fQuickRejects, slot.fQuickRejects);
+        stats.fScratchBytesPeak = std::max<uint64_t>(stats.fScratchBytesPeak,
+                                                     slot.fScratchBytesPeak.load(std::memory_order_relaxed));
+    }
+    ReadAllocs(*this, stats.fAllocations);
+    return stats;
+}
+
+void CanvasStats::reset() {
+    for (int s = 0; s < fSlotCount; s++) {
+        Slot &slot = fSlots[s];
+        for (Counter &c : slot.fDraws) c.store(0, std::memory_order_relaxed);
+        for (Counter &c : slot.fBlendedPixels) c.store(0, std::memory_order_relaxed);
+        for (Counter &c : slot.fShadeRowCalls) c.store(0, std::memory_order_relaxed);
+        for (Counter &c : slot.fShadedPixels) c.store(0, std::memory_order_relaxed);
+        for (Counter *c : {&slot.fEdgesBuilt, &slot.fEdgesClipped, &slot.fScanlines, &slot.fSpans,
+                           &slot.fFillFastPath, &slot.fDstSkips, &slot.fQuickRejects,
+                           &slot.fScratchBytesPeak}) {
+            c->store(0, std::memory_order_relaxed);
+        }
+    }
+    ResetAllocs(this);
+}
@@ -0,0 +1,36 @@
+#ifndef _ALLOCS_H
+#define _ALLOCS_H
+
+#include "_stats.h"
+
+// Opt-in accounting of operator new/delete (see GSetAllocTracking). Only when built with
+// -DG_ALLOC_TRACKING does the library replace the global allocation functions; while tracking is
+// then on, every allocation made inside an AllocScope is recorded against that scope's canvas and
+// primitive until it is freed. Otherwise scopes only mark the thread, and nothing is recorded.
+
+// Attributes this thread's allocations to stats/primitive until it goes out of scope, along with
+// those of any pool work it hands off (the scope is the thread's GGetTaskContext(), so that work
+// must finish first, as a draw's does). Scopes do not nest: an inner scope (e.g. drawQuad ->
+// drawMesh) leaves the outer one in charge.
+class AllocScope {
+   public:
+    AllocScope(CanvasStats *stats, GCanvasStats::Primitive primitive);
+    ~AllocScope();
+
+    CanvasStats *stats() const { return fStats; }
+    GCanvasStats::Primitive primitive() const { return fPrimitive; }
+
+   private:
+    CanvasStats *fStats;
+    GCanvasStats::Primitive fPrimitive;
+    bool fActive;
+};
+
+// These take the tracker's lock.
+void ReadAllocs(const CanvasStats &stats, GCanvasStats::Allocations out[]);
+void ResetAllocs(CanvasStats *stats);
+
+// Stop attributing anything to stats, which is going away.
+void ForgetAllocs(CanvasStats *stats);
+
+#endif
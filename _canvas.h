@@ -7,18 +7,27 @@
 
 #include <stack>
 
+#include "include/GArena.h"
 #include "include/GBitmap.h"
 #include "include/GCanvas.h"
 #include "include/GColor.h"
 #include "include/GPaint.h"
 #include "include/GRect.h"
+#include "include/GRegion.h"
+#include "_clip.h"
+#include "_lazyClear.h"
+#include "_stats.h"
 
 class MyCanvas : public GCanvas {
    public:
-    MyCanvas(const GBitmap &device) : fDevice(device) {
+    MyCanvas(const GBitmap &device, bool deferClears = false) : fDevice(device), fLazyClear(device, deferClears) {
         ctmStack.push(GMatrix());
+        fClipStack.push(std::make_shared<const Clip>(device.width(), device.height()));
     }
 
+    // writes out a clear that no one flushed
+    virtual ~MyCanvas() override { fLazyClear.resolve(); }
+
     virtual void clear(const GColor &color) override;
 
     virtual void drawRect(const GRect &rect, const GPaint &color) override;
@@ -31,6 +40,12 @@ class MyCanvas : public GCanvas {
 
     virtual void concat(const GMatrix &matrix) override;
 
+    virtual void clipRect(const GRect &rect) override;
+
+    virtual void clipPath(const GPath &path) override;
+
+    virtual void clipRegion(const GRegion &region) override;
+
     virtual void drawPath(const GPath &path, const GPaint &paint) override;
 
     virtual void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
@@ -39,9 +54,49 @@ class MyCanvas : public GCanvas {
     virtual void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
                           int level, const GPaint &) override;
 
+    virtual GCanvasStats stats() const override;
+
+    virtual void resetStats() override;
+
+    virtual void flush() override;
+
+    virtual bool getDamage(GRegion *damage) const override;
+
+    virtual void resetDamage() override;
+
+    // Count every pixel write into counts (sized to the device), or stop counting if null.
+    void setOverdrawCounts(OverdrawCounts *counts) { fOverdraw = counts; }
+
    private:
+    // the bodies of drawConvexPolygon and drawMesh, shared with the draws built on them so that
+    // only the public call is counted in the stats
+    void fillConvexPolygon(const GPoint vertices[], int count, const GPaint &paint);
+    void fillMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
+                  int count, const int indices[], const GPaint &paint);
+
+    // Whether a draw whose device-space bounds are these misses the clip entirely. Counts the
+    // draw as quick-rejected if so.
+    bool quickReject(const GRect &bounds);
+
+    // Add the pixels a draw with these device-space bounds may touch, inside the clip, to fDamage.
+    void addDamage(const GRect &bounds);
+
+    // Called as each draw starts: nothing in the arena outlives a draw, so if a client never
+    // returns to save level 0 the arena is recycled here once it gets large.
+    void recycleArena();
+
     const GBitmap fDevice;
+    // the last clear(), filled in a tile at a time as draws reach it
+    LazyClear fLazyClear;
     std::stack<GMatrix> ctmStack;
+    // saved and restored along with the CTM
+    std::stack<std::shared_ptr<const Clip>> fClipStack;
+    CanvasStats fStats;
+    // everything drawn since resetDamage()
+    GRegion fDamage;
+    OverdrawCounts *fOverdraw = nullptr;
+    // edge lists and mesh shaders for the current frame
+    GArena fArena;
 };
 
 #endif  // PA1_MAFFANNAUSHAHI_MAIN_MYCANVAS_H
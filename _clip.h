@@ -0,0 +1,57 @@
+#ifndef _CLIP_H
+#define _CLIP_H
+
+#include <memory>
+
+#include "_clipping.h"
+#include "include/GRect.h"
+#include "include/GRegion.h"
+
+// One state of a MyCanvas's clip, in device pixels. Clips never change once made: clipping makes
+// a new one, so save() only has to copy a pointer and every draw until restore() shares it.
+//
+// The rasterizers clip their edges to the device, never to the clip, so the clip only limits
+// which rows they walk and which pixels of each span they write: a rect clip cuts spans to its
+// bounds, and anything else is a GRegion whose runs each span is cut against.
+class Clip {
+   public:
+    // all of a device this size
+    Clip(int width, int height) : fRegion(GIRect::WH(width, height)) {}
+    explicit Clip(GRegion region) : fRegion(std::move(region)) {}
+
+    // pixels outside this are never drawn; empty if nothing is
+    const GIRect &bounds() const { return fRegion.bounds(); }
+    bool isEmpty() const { return fRegion.isEmpty(); }
+    bool isRect() const { return fRegion.isRect(); }
+    const GRegion &region() const { return fRegion; }
+
+    // whether every pixel of r is inside the clip
+    bool contains(const GIRect &r) const { return fRegion.contains(r); }
+
+    // This clip intersected with a device rect, or region.
+    std::shared_ptr<const Clip> intersect(const GIRect &r) const;
+    std::shared_ptr<const Clip> intersect(const GRegion &region) const;
+
+    // This clip intersected with the area the edges enclose under the nonzero winding rule. The
+    // edges must be sorted by top and clipped to the device (not to bounds(), as that would move
+    // their ends; see drawConvexPolygonTemplate).
+    std::shared_ptr<const Clip> intersect(const EdgeList &sortedEdges) const;
+
+    // Call proc(left, right) for each non-empty piece of [L, R) on row y inside the clip. The
+    // span must already lie within bounds().
+    template <typename Proc>
+    void forEachSpan(int L, int R, int y, Proc proc) const {
+        if (this->isRect()) {
+            if (L < R) {
+                proc(L, R);
+            }
+            return;
+        }
+        fRegion.forEachSpan(L, R, y, proc);
+    }
+
+   private:
+    const GRegion fRegion;
+};
+
+#endif
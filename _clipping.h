@@ -1,5 +1,9 @@
+#ifndef _CLIPPING_H
+#define _CLIPPING_H
+
 #include <iostream>
 
+#include "include/GArena.h"
 #include "include/GBitmap.h"
 #include "include/GMath.h"
 #include "include/GPath.h"
@@ -43,12 +47,22 @@ struct Edge {
     }
 };
 
-std::vector<Edge> createEdges(const GPoint vertices[], int count, int top, int bottom);
+// edge lists live in the canvas's per-frame arena
+typedef std::vector<Edge, GArenaAllocator<Edge>> EdgeList;
+
+// The edge builders append to edges, clipped to clip: edges left or right of it are pinned to its
+// sides, and nothing above or below it is kept. clipped, if not null, is incremented for each
+// segment that clipping discards entirely.
+void createEdges(const GPoint vertices[], int count, const GIRect& clip, EdgeList& edges, int* clipped = nullptr);
 
 bool verticalClipping(GPoint& p1, GPoint& p2, int top, int bottom);
 
-std::vector<GPoint> horizontalClipping(GPoint& p1, GPoint& p2, int left, int right);
+// Writes up to 4 points to pts and returns how many.
+int horizontalClipping(GPoint& p1, GPoint& p2, int left, int right, GPoint pts[4]);
+
+void createPathEdges(GPoint p0, GPoint p1, const GIRect& clip, EdgeList& edges, int* clipped = nullptr);
 
-std::vector<Edge> createPathEdges(GPoint p0, GPoint p1, int bottom, int right);
+// The path's points are mapped by ctm as they are read, so the path need not be copied.
+void processPath(const GPath& path, const GMatrix& ctm, const GIRect& clip, EdgeList& edges, int* clipped = nullptr);
 
-std::vector<Edge> processPath(const GPath& path, const GBitmap& fDevice);
+#endif
@@ -0,0 +1,60 @@
+#ifndef _LAZY_CLEAR_H
+#define _LAZY_CLEAR_H
+
+#include <vector>
+
+#include "include/GBitmap.h"
+#include "include/GRect.h"
+
+// Deferred clears for one MyCanvas. clear() only records the color: each kTileSize square tile
+// stays "pending" until a draw is about to touch it, and tiles no draw touches are filled all at
+// once by resolve(). Before every rasterization, prepare() fills the pending tiles under the
+// draw and remembers them, so that while it runs a pixel in one of them is known to hold the
+// clear color.
+//
+// Anyone else reading or writing the pixels before resolve() would see stale tiles, so only a
+// canvas created to defer (GCreateDeferredCanvas) does; any other writes its clears at once.
+class LazyClear {
+   public:
+    static constexpr int kTileShift = 6;
+    static constexpr int kTileSize = 1 << kTileShift;
+
+    LazyClear(const GBitmap &device, bool defer);
+
+    // Fill the whole device with color, deferred if this was created to defer.
+    void clear(GPixel color);
+
+    // A draw is about to write (or read) the pixels in bounds.
+    void prepare(GIRect bounds);
+
+    // Write out every tile still pending. Call before anyone reads the device's pixels.
+    void resolve();
+
+    // Whether the tile holding (x, y) held nothing but color() when the current draw began.
+    bool known(int x, int y) const {
+        return fState[(y >> kTileShift) * fColumns + (x >> kTileShift)] == kKnown;
+    }
+    bool anyKnown() const { return !fKnown.empty(); }
+    GPixel color() const { return fColor; }
+
+   private:
+    enum State : uint8_t {
+        kWritten,   // the pixels are real
+        kPending,   // the pixels are stale; logically the tile is fColor
+        kKnown,     // written with fColor by the current draw's prepare()
+    };
+
+    // fills the pending tiles of [left, right) x [top, bottom), in tile units
+    void fillPending(int left, int top, int right, int bottom);
+
+    const GBitmap fDevice;
+    const bool fDefer;
+    const int fColumns;
+    const int fRows;
+    std::vector<State> fState;
+    std::vector<int> fKnown;        // indices of the tiles in kKnown
+    int fPendingCount = 0;
+    GPixel fColor = 0;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "include/GBlendMode.h"
+#include "include/GCanvasStats.h"
+
+// Counters owned by one MyCanvas. Each pool worker writes its own slot without a locked
+// instruction; every other thread, and any worker the pool grew past since the canvas was made,
+// shares slot 0 and adds to it atomically. stats() sums the slots.
+class CanvasStats {
+   public:
+    CanvasStats();
+
+    void addDraw(GCanvasStats::Primitive primitive) { Slot &s = local(); add(s, s.fDraws[primitive], 1); }
+    void addEdges(uint64_t built, uint64_t clipped);
+    void addRows(uint64_t scanlines, uint64_t spans, GBlendMode mode, uint64_t pixels);
+    void addShaded(int shaderType, uint64_t calls, uint64_t pixels);
+    void addFillFastPath() { Slot &s = local(); add(s, s.fFillFastPath, 1); }
+    void addDstSkip() { Slot &s = local(); add(s, s.fDstSkips, 1); }
+    void addQuickReject() { Slot &s = local(); add(s, s.fQuickRejects, 1); }
+    void noteScratch(uint64_t bytes);
+
+    ~CanvasStats();
+
+    GCanvasStats read() const;
+
+    // Zeroes everything except the bytes still live, which stay attributed to this canvas.
+    void reset();
+
+    // Written by the allocation tracker (see _allocs.h), under its lock.
+    struct AllocCounters {
+        uint64_t fCount;
+        uint64_t fBytes;
+        uint64_t fLiveBytes;
+        uint64_t fPeakBytes;
+    };
+    AllocCounters fAllocs[GCanvasStats::kPrimitiveCount] = {};
+
+   private:
+    typedef std::atomic<uint64_t> Counter;
+
+    struct alignas(64) Slot {
+        Counter fDraws[GCanvasStats::kPrimitiveCount];
+        Counter fEdgesBuilt;
+        Counter fEdgesClipped;
+        Counter fScanlines;
+        Counter fSpans;
+        Counter fBlendedPixels[GCanvasStats::kBlendModeCount];
+        Counter fShadeRowCalls[GCanvasStats::kShaderTypeCount];
+        Counter fShadedPixels[GCanvasStats::kShaderTypeCount];
+        Counter fFillFastPath;
+        Counter fDstSkips;
+        Counter fQuickRejects;
+        Counter fScratchBytesPeak;
+    };
+
+    // only its worker writes a slot past 0, so a relaxed load + store is enough there
+    void add(Slot &slot, Counter &counter, uint64_t n) {
+        if (&slot == &fSlots[0]) {
+            counter.fetch_add(n, std::memory_order_relaxed);
+        } else {
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+    }
+
+    Slot &local();
+
+    int fSlotCount;     // 1 + the pool's worker count when the canvas was made
+    std::unique_ptr<Slot[]> fSlots;
+};
+
+// How many times each device pixel has been written, for the overdraw debug canvas. Counts
+// saturate at 0xFFFF. Bands write disjoint rows, so no synchronization is needed.
+class OverdrawCounts {
+   public:
+    OverdrawCounts(int width, int height) : fWidth(width), fHeight(height), fCounts((size_t)width * height, 0) {}
+
+    void addSpan(int x, int y, int count) {
+        uint16_t *c = &fCounts[(size_t)y * fWidth + x];
+        for (int i = 0; i < count; i++) {
+            c[i] += c[i] != 0xFFFF;
+        }
+    }
+
+    int width() const { return fWidth; }
+    int height() const { return fHeight; }
+    const uint16_t *counts() const { return fCounts.data(); }
+    void reset() { std::fill(fCounts.begin(), fCounts.end(), 0); }
+
+   private:
+    int fWidth;
+    int fHeight;
+    std::vector<uint16_t> fCounts;
+};
+
+// What a draw template reports back for the rows it fills. Bands running on different threads
+// each report their own rows.
+struct DrawCounters {
+    CanvasStats *fStats;
+    GBlendMode fMode;    // the mode after optimize_mode()
+    int fShaderType;     // a GCanvasStats::ShaderType, or -1 without a shader
+    OverdrawCounts *fOverdraw;   // null unless drawing into an overdraw canvas
+
+    // every span of a shaded draw is one shadeRow() call
+    void addRows(uint64_t scanlines, uint64_t spans, uint64_t pixels) const {
+        fStats->addRows(scanlines, spans, fMode, pixels);
+        if (fShaderType >= 0) {
+            fStats->addShaded(fShaderType, spans, pixels);
+        }
+    }
+
+    // called for every span of pixels written
+    void addWrites(int x, int y, int count) const {
+        if (fOverdraw) {
+            fOverdraw->addSpan(x, y, count);
+        }
+    }
+};
+
+#endif
@@ -43,14 +43,15 @@ class TriColorShader : public GShader {
     void shadeRow(int x, int y, int count, GPixel row[]) override {
         GColor dc1 = fC1 - fC0;  // delta color 1
         GColor dc2 = fC2 - fC0;  // delta color 2
-        GPoint p = GPoint{x + 0.5f, y + 0.5f};
-        GPoint p_prime = fInverse * p;  // (x, y) in local space
-        GColor c = p_prime.x * dc1 + p_prime.y * dc2 + fC0;
+        // the color at x = 0 of this row, and its change per pixel
+        GColor c = (fInverse[2] * (y + 0.5f) + fInverse[4]) * dc1 + (fInverse[3] * (y + 0.5f) + fInverse[5]) * dc2 + fC0;
         GColor dc = fInverse[0] * dc1 + fInverse[1] * dc2;
 
+        // computed per pixel rather than stepped, so a span gets the same pixels wherever it
+        // starts (e.g. where a clip cuts it)
+        const float left = x + 0.5f;
         for (int i = 0; i < count; i++) {
-            row[i] = ConvertColorToPixel(c);
-            c += dc;
+            row[i] = ConvertColorToPixel(c + (left + i) * dc);
         }
     }
 
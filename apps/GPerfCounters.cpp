@@ -0,0 +1,87 @@
+#include "GPerfCounters.h"
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int open_counter(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;    // allowed without privileges
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t cache_config(uint64_t cache, uint64_t result) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+}
+
+GPerfCounters::GPerfCounters() {
+    fFD[kCycles] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fFD[kInstructions] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fFD[kL1DMisses] = open_counter(PERF_TYPE_HW_CACHE,
+                                   cache_config(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS));
+    fFD[kLLCMisses] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    fFD[kBranchMisses] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    memset(fValue, 0, sizeof(fValue));
+}
+
+GPerfCounters::~GPerfCounters() {
+    for (int fd : fFD) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void GPerfCounters::start() {
+    for (int fd : fFD) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void GPerfCounters::stop() {
+    for (int i = 0; i < kCount; ++i) {
+        fValue[i] = 0;
+        if (fFD[i] >= 0) {
+            ioctl(fFD[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fFD[i], &fValue[i], sizeof(fValue[i])) != sizeof(fValue[i])) {
+                fValue[i] = 0;
+            }
+        }
+    }
+}
+
+#else
+
+GPerfCounters::GPerfCounters() {
+    for (int i = 0; i < kCount; ++i) {
+        fFD[i] = -1;
+        fValue[i] = 0;
+    }
+}
+
+GPerfCounters::~GPerfCounters() {}
+void GPerfCounters::start() {}
+void GPerfCounters::stop() {}
+
+#endif
+
+bool GPerfCounters::hasAny() const {
+    for (int fd : fFD) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,42 @@
+#ifndef GPerfCounters_DEFINED
+#define GPerfCounters_DEFINED
+
+#include "../include/GTypes.h"
+
+/**
+ *  Hardware performance counters for the calling thread, read through perf_event_open on Linux.
+ *
+ *  Any counter the kernel refuses (no PMU in a container or VM, perf_event_paranoid, other
+ *  platforms) is simply left unavailable; has() reports which ones are live.
+ */
+class GPerfCounters {
+public:
+    enum Counter {
+        kCycles,
+        kInstructions,
+        kL1DMisses,
+        kLLCMisses,
+        kBranchMisses,
+        kCount,
+    };
+
+    GPerfCounters();
+    ~GPerfCounters();
+
+    bool has(Counter c) const { return fFD[c] >= 0; }
+    bool hasAny() const;
+
+    // Zero and start every available counter.
+    void start();
+
+    // Stop counting and latch the totals since start().
+    void stop();
+
+    uint64_t value(Counter c) const { return fValue[c]; }
+
+private:
+    int      fFD[kCount];
+    uint64_t fValue[kCount];
+};
+
+#endif
@@ -176,6 +176,7 @@ int GWindow::run() {
         if (fNeedDraw) {
             fNeedDraw = false;  // clear this before we call onDraw
             this->onUpdate(fBitmap, fCanvas.get());
+            fCanvas->flush();
             SDL_UpdateTexture(fTexture, nullptr, fBitmap.pixels(), fBitmap.rowBytes());
         }
         SDL_RenderCopy(fRenderer, fTexture, nullptr, nullptr);
@@ -0,0 +1,328 @@
+#include "bench.h"
+#include "GPerfCounters.h"
+#include "../include/GCanvas.h"
+#include "../include/GBitmap.h"
+#include "../include/GOwnedBitmap.h"
+#include "../include/GScheduler.h"
+#include <algorithm>
+#include <map>
+#include <string>
+
+static const GNSec kWarmupNS = 50 * 1000 * 1000;
+static const GNSec kMinSampleNS = 1000 * 1000;
+
+GBenchStats GRunBench(const std::function<void(GCanvas*)>& draw, int width, int height,
+                      int64_t pixels, int samples, GPerfCounters* counters) {
+    GOwnedBitmap bitmap(width, height);
+    // nothing else touches the bitmap, so clears can wait for the draws
+    auto canvas = GCreateDeferredCanvas(bitmap);
+    assert(canvas);
+
+    // warm up caches and the worker pool, and see how long one call takes
+    int warmupCalls = 0;
+    GNSec start = GTime::GetNSec();
+    GNSec elapsed = 0;
+    while (warmupCalls < 2 || elapsed < kWarmupNS) {
+        draw(canvas.get());
+        warmupCalls += 1;
+        elapsed = GTime::GetNSec() - start;
+    }
+    int loops = (int)std::max<GNSec>(1, kMinSampleNS * warmupCalls / std::max<GNSec>(elapsed, 1));
+
+    // only count allocations from the timed calls; bytes the warmup leaked stay live
+    canvas->resetStats();
+    uint64_t liveBefore = 0;
+    for (const auto& a : canvas->stats().fAllocations) {
+        liveBefore += a.fLiveBytes;
+    }
+
+    std::vector<double> times;
+    if (counters) {
+        counters->start();
+    }
+    for (int i = 0; i < samples; ++i) {
+        GNSec t0 = GTime::GetNSec();
+        for (int j = 0; j < loops; ++j) {
+            draw(canvas.get());
+        }
+        times.push_back((double)(GTime::GetNSec() - t0) / loops);
+    }
+    if (counters) {
+        counters->stop();
+    }
+    std::sort(times.begin(), times.end());
+
+    GBenchStats stats;
+    stats.fLoops = loops;
+    stats.fSamples = samples;
+    stats.fMedianNS = times[times.size() / 2];
+    stats.fP95NS = times[std::min(times.size() - 1, times.size() * 95 / 100)];
+    if (pixels <= 0) {
+        pixels = (int64_t)width * height;
+    }
+    stats.fMPixPerSec = pixels * 1e3 / stats.fMedianNS;
+    stats.fNSPerPixel = stats.fMedianNS / pixels;
+
+    stats.fIPC = stats.fL1DMissesPerPixel = stats.fLLCMissesPerPixel = stats.fBranchMissesPerPixel = -1;
+    if (counters) {
+        const double totalPixels = (double)pixels * loops * samples;
+        auto perPixel = [&](GPerfCounters::Counter c) {
+            return counters->has(c) ? counters->value(c) / totalPixels : -1;
+        };
+        if (counters->has(GPerfCounters::kCycles) && counters->has(GPerfCounters::kInstructions) &&
+            counters->value(GPerfCounters::kCycles) > 0) {
+            stats.fIPC = (double)counters->value(GPerfCounters::kInstructions) /
+                         counters->value(GPerfCounters::kCycles);
+        }
+        stats.fL1DMissesPerPixel = perPixel(GPerfCounters::kL1DMisses);
+        stats.fLLCMissesPerPixel = perPixel(GPerfCounters::kLLCMisses);
+        stats.fBranchMissesPerPixel = perPixel(GPerfCounters::kBranchMisses);
+    }
+
+    stats.fAllocsPerCall = stats.fAllocBytesPerCall = stats.fAllocPeakBytes = stats.fLeakedBytesPerCall = -1;
+    if (GGetAllocTracking()) {
+        const double calls = (double)loops * samples;
+        uint64_t count = 0, bytes = 0, peak = 0, live = 0;
+        for (const auto& a : canvas->stats().fAllocations) {
+            count += a.fCount;
+            bytes += a.fBytes;
+            peak = std::max(peak, a.fPeakBytes);
+            live += a.fLiveBytes;
+        }
+        stats.fAllocsPerCall = count / calls;
+        stats.fAllocBytesPerCall = bytes / calls;
+        stats.fAllocPeakBytes = (double)peak;
+        // the timed calls may free what the warmup left live, which is not a leak either
+        stats.fLeakedBytesPerCall = live > liveBefore ? (live - liveBefore) / calls : 0;
+    }
+
+    canvas.reset();
+    return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool is_arg(const char arg[], const char name[]) {
+    std::string str("--");
+    str += name;
+    if (!strcmp(arg, str.c_str())) {
+        return true;
+    }
+
+    char shortVers[3];
+    shortVers[0] = '-';
+    shortVers[1] = name[0];
+    shortVers[2] = 0;
+    return !strcmp(arg, shortVers);
+}
+
+// Reads the median of each benchmark from a file written by --json.
+static std::map<std::string, double> read_baseline(const char path[]) {
+    std::map<std::string, double> medians;
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        printf("------- failed to read %s\n", path);
+        return medians;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        const char* name = strstr(line, "\"name\": \"");
+        const char* median = strstr(line, "\"median_ns\": ");
+        if (!name || !median) {
+            continue;
+        }
+        name += strlen("\"name\": \"");
+        const char* end = strchr(name, '"');
+        if (!end) {
+            continue;
+        }
+        medians[std::string(name, end - name)] = atof(median + strlen("\"median_ns\": "));
+    }
+    fclose(f);
+    return medians;
+}
+
+static void print_counter(const char fmt[], double value) {
+    if (value < 0) {
+        // keep the column width of fmt
+        printf(" %*s", atoi(fmt + 2), "-");
+    } else {
+        printf(fmt, value);
+    }
+}
+
+static void json_counter(FILE* f, const char name[], double value) {
+    if (value < 0) {
+        fprintf(f, ", \"%s\": null", name);
+    } else {
+        fprintf(f, ", \"%s\": %.4f", name, value);
+    }
+}
+
+static int max_name_len() {
+    size_t len = 0;
+    for (int i = 0; gBenchRecs[i].fDraw; ++i) {
+        len = std::max(len, strlen(gBenchRecs[i].fName));
+    }
+    return (int)len;
+}
+
+extern int main_bench_micro(const char* match, int samples);
+extern int main_bench_scale(const char* csvPath, int maxSize, int samples);
+
+int main_bench(int argc, const char* argv[]) {
+    const char* match = nullptr;
+    const char* jsonFile = nullptr;
+    const char* baseFile = nullptr;
+    const char* csvFile = nullptr;
+    int samples = 0;
+    int maxSize = 4096;
+    bool micro = false;
+    bool scale = false;
+    bool useCounters = false;
+    bool trackAllocs = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (is_arg(argv[i], "match") && i+1 < argc) {
+            match = argv[++i];
+        } else if (is_arg(argv[i], "samples") && i+1 < argc) {
+            samples = std::max(1, atoi(argv[++i]));
+        } else if (is_arg(argv[i], "json") && i+1 < argc) {
+            jsonFile = argv[++i];
+        } else if (is_arg(argv[i], "compare") && i+1 < argc) {
+            baseFile = argv[++i];
+        } else if (is_arg(argv[i], "csv") && i+1 < argc) {
+            csvFile = argv[++i];
+        } else if (!strcmp(argv[i], "--max-size") && i+1 < argc) {
+            maxSize = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--counters")) {
+            useCounters = true;
+        } else if (!strcmp(argv[i], "--allocs")) {
+            trackAllocs = true;
+        } else if (!strcmp(argv[i], "--micro")) {
+            micro = true;
+        } else if (!strcmp(argv[i], "--scale")) {
+            scale = true;
+        } else {
+            printf("usage: bench [--match substring] [--samples count] [--json file] [--compare file]\n"
+                   "             [--counters] [--allocs] [--micro] [--scale [--csv file] [--max-size pixels]]\n");
+            return -1;
+        }
+    }
+
+    if (micro) {
+        return main_bench_micro(match, samples ? samples : 10);
+    }
+    if (scale) {
+        // 16384 x 16384 needs a 1GB canvas, so it is opt-in with --max-size
+        return main_bench_scale(csvFile, maxSize, samples ? samples : 5);
+    }
+    if (!samples) {
+        samples = 30;
+    }
+
+    std::map<std::string, double> baseline;
+    if (baseFile) {
+        baseline = read_baseline(baseFile);
+    }
+
+    std::unique_ptr<GPerfCounters> counters;
+    if (useCounters) {
+        counters.reset(new GPerfCounters);
+        if (counters->hasAny()) {
+            // the counters only see this thread, so keep all of the work on it
+            GSetWorkerCount(0);
+        } else {
+            printf("------- hardware counters are not available, reporting times only\n");
+            counters.reset();
+        }
+    }
+
+    if (trackAllocs) {
+        // slows every allocation down, so times are not comparable with untracked runs
+        GSetAllocTracking(true);
+        if (!GGetAllocTracking()) {
+            printf("------- --allocs needs allocation tracking compiled in (make bench CPPFLAGS=-DG_ALLOC_TRACKING)\n");
+            return -1;
+        }
+    }
+
+    FILE* json = nullptr;
+    if (jsonFile) {
+        json = fopen(jsonFile, "w");
+        if (!json) {
+            printf("------- failed to create %s\n", jsonFile);
+            return -1;
+        }
+        fprintf(json, "{\n  \"benchmarks\": [\n");
+    }
+
+    const int nameLen = max_name_len();
+    printf("%-*s %12s %12s %10s %9s", nameLen, "bench", "median(us)", "p95(us)", "Mpix/s", "ns/pix");
+    if (counters) {
+        printf(" %6s %8s %8s %8s", "IPC", "L1D/pix", "LLC/pix", "br/pix");
+    }
+    if (trackAllocs) {
+        printf(" %9s %11s %10s %10s", "allocs", "bytes", "peak", "leaked");
+    }
+    printf("%s\n", baseFile ? "    vs base" : "");
+
+    bool first = true;
+    for (int i = 0; gBenchRecs[i].fDraw; ++i) {
+        const GBenchRec& rec = gBenchRecs[i];
+        if (match && !strstr(rec.fName, match)) {
+            continue;
+        }
+
+        GBenchStats stats = GRunBench(rec.fDraw, rec.fWidth, rec.fHeight, rec.fPixels, samples,
+                                      counters.get());
+
+        printf("%-*s %12.2f %12.2f %10.1f %9.3f", nameLen, rec.fName,
+               stats.fMedianNS / 1000, stats.fP95NS / 1000, stats.fMPixPerSec, stats.fNSPerPixel);
+        if (counters) {
+            print_counter(" %6.2f", stats.fIPC);
+            print_counter(" %8.4f", stats.fL1DMissesPerPixel);
+            print_counter(" %8.4f", stats.fLLCMissesPerPixel);
+            print_counter(" %8.4f", stats.fBranchMissesPerPixel);
+        }
+        if (trackAllocs) {
+            printf(" %9.1f %11.0f %10.0f %10.0f", stats.fAllocsPerCall, stats.fAllocBytesPerCall,
+                   stats.fAllocPeakBytes, stats.fLeakedBytesPerCall);
+        }
+        auto base = baseline.find(rec.fName);
+        if (base != baseline.end() && base->second > 0) {
+            // positive means slower than the baseline
+            printf("   %+7.1f%%", (stats.fMedianNS / base->second - 1) * 100);
+        }
+        printf("\n");
+
+        if (json) {
+            fprintf(json, "%s    {\"name\": \"%s\", \"width\": %d, \"height\": %d, \"loops\": %d, "
+                          "\"samples\": %d, \"median_ns\": %.1f, \"p95_ns\": %.1f, "
+                          "\"mpix_per_sec\": %.3f, \"ns_per_pixel\": %.4f",
+                    first ? "" : ",\n", rec.fName, rec.fWidth, rec.fHeight, stats.fLoops,
+                    stats.fSamples, stats.fMedianNS, stats.fP95NS, stats.fMPixPerSec,
+                    stats.fNSPerPixel);
+            if (counters) {
+                json_counter(json, "ipc", stats.fIPC);
+                json_counter(json, "l1d_misses_per_pixel", stats.fL1DMissesPerPixel);
+                json_counter(json, "llc_misses_per_pixel", stats.fLLCMissesPerPixel);
+                json_counter(json, "branch_misses_per_pixel", stats.fBranchMissesPerPixel);
+            }
+            if (trackAllocs) {
+                json_counter(json, "allocs_per_call", stats.fAllocsPerCall);
+                json_counter(json, "alloc_bytes_per_call", stats.fAllocBytesPerCall);
+                json_counter(json, "alloc_peak_bytes", stats.fAllocPeakBytes);
+                json_counter(json, "leaked_bytes_per_call", stats.fLeakedBytesPerCall);
+            }
+            fprintf(json, "}");
+            first = false;
+        }
+    }
+
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        fclose(json);
+    }
+    return 0;
+}
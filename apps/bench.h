@@ -0,0 +1,56 @@
+#ifndef G_bench_DEFINED
+#define G_bench_DEFINED
+
+#include <functional>
+
+#include "../include/GTime.h"
+
+class GCanvas;
+class GPerfCounters;
+
+struct GBenchRec {
+    void        (*fDraw)(GCanvas*);
+    int         fWidth;
+    int         fHeight;
+    const char* fName;
+    int64_t     fPixels;    // pixels written by one fDraw call, or 0 for the whole canvas
+};
+
+/*
+ *  Array is terminated when fDraw is NULL
+ */
+extern const GBenchRec gBenchRecs[];
+
+struct GBenchStats {
+    int     fLoops;         // fDraw calls per sample
+    int     fSamples;
+    double  fMedianNS;      // per fDraw call
+    double  fP95NS;
+    double  fMPixPerSec;    // based on the median
+    double  fNSPerPixel;
+
+    // hardware counters over all samples, or negative when unavailable
+    double  fIPC;
+    double  fL1DMissesPerPixel;
+    double  fLLCMissesPerPixel;
+    double  fBranchMissesPerPixel;
+
+    // operator new traffic per fDraw call, or negative unless GSetAllocTracking(true)
+    double  fAllocsPerCall;
+    double  fAllocBytesPerCall;
+    double  fAllocPeakBytes;        // most bytes live at once, for the worst primitive
+    double  fLeakedBytesPerCall;    // still live after the samples
+};
+
+/**
+ *  Time draw() on a width x height canvas. It is warmed up first, then timed for the requested
+ *  number of samples. Each sample repeats draw() enough times to last at least a millisecond,
+ *  and the stats are reported per call.
+ *
+ *  If counters is not null, it is started and stopped around the timed samples. It only counts
+ *  the calling thread.
+ */
+GBenchStats GRunBench(const std::function<void(GCanvas*)>& draw, int width, int height,
+                      int64_t pixels, int samples, GPerfCounters* counters = nullptr);
+
+#endif
@@ -0,0 +1,130 @@
+/*
+ *  Blend mode x paint source x span length matrix.
+ *
+ *  Each draw is a rect kRows tall, so it emits kRows spans of the given length. The per-pixel cost
+ *  is the slope between the two longest spans, where the fixed cost is amortized away. What is
+ *  left of the 1-pixel span is the fixed cost of a span (shadeRow dispatch, row buffer setup,
+ *  address math, plus its share of the draw call).
+ */
+
+#include "bench.h"
+#include "../_blend.h"
+#include "../_compositeShader.h"
+#include "../_triColorShader.h"
+#include "../include/GBitmap.h"
+#include "../include/GCanvas.h"
+#include "../include/GMatrix.h"
+#include "../include/GScheduler.h"
+#include "../include/GShader.h"
+#include <string>
+
+static const int kSpanLengths[] = { 1, 4, 16, 64, 256, 4096 };
+static const int kRows = 64;
+
+static const GBlendMode kModes[] = {
+    GBlendMode::kClear, GBlendMode::kSrc,     GBlendMode::kDst,     GBlendMode::kSrcOver,
+    GBlendMode::kDstOver, GBlendMode::kSrcIn, GBlendMode::kDstIn,   GBlendMode::kSrcOut,
+    GBlendMode::kDstOut,  GBlendMode::kSrcATop, GBlendMode::kDstATop, GBlendMode::kXor,
+};
+
+static const char* const kModeNames[] = {
+    "clear", "src", "dst", "srcover", "dstover", "srcin",
+    "dstin", "srcout", "dstout", "srcatop", "dstatop", "xor",
+};
+
+struct PaintSource {
+    const char* fName;
+    GShader*    fShader;
+};
+
+// a 256x256 checker, either opaque or with alpha varying across it
+static void make_pattern(GBitmap* bm, bool opaque) {
+    bm->alloc(256, 256);
+    for (int y = 0; y < 256; ++y) {
+        for (int x = 0; x < 256; ++x) {
+            unsigned a = opaque ? 255 : (x + y) / 2;
+            unsigned c = ((x ^ y) & 16) ? a : a / 3;
+            *bm->getAddr(x, y) = GPixel_PackARGB(a, c, a - c, c / 2);
+        }
+    }
+    bm->setIsOpaque(opaque ? GBitmap::kYes_IsOpaque : GBitmap::kNo_IsOpaque);
+}
+
+int main_bench_micro(const char* match, int samples) {
+    // per-pixel costs are measured on a single thread
+    GSetWorkerCount(0);
+
+    GBitmap opaqueBM, alphaBM;
+    make_pattern(&opaqueBM, true);
+    make_pattern(&alphaBM, false);
+
+    const GColor two[] = {{1, 0, 0, 1}, {0, 0, 1, 0.5f}};
+    const GColor many[] = {{1, 0, 0, 1}, {1, 1, 0, 1}, {0, 1, 0, 0.5f}, {0, 1, 1, 1},
+                           {0, 0, 1, 1}, {1, 0, 1, 0.25f}, {1, 1, 1, 1}, {0, 0, 0, 1}};
+    const float W = (float)kSpanLengths[GARRAY_COUNT(kSpanLengths) - 1];
+
+    auto opaqueShader = GCreateBitmapShader(opaqueBM, GMatrix::Scale(0.5f, 0.5f), GTileMode::kRepeat);
+    auto alphaShader = GCreateBitmapShader(alphaBM, GMatrix::Scale(0.5f, 0.5f), GTileMode::kRepeat);
+    auto twoStop = GCreateLinearGradient({0, 0}, {W, kRows}, two, 2);
+    auto manyStop = GCreateLinearGradient({0, 0}, {W, kRows}, many, GARRAY_COUNT(many));
+    TriColorShader triColor({0, 0}, {W, 0}, {0, kRows}, {1, 0, 0, 1}, {0, 1, 0, 0.5f}, {0, 0, 1, 1});
+    CompositeShader composite(&triColor, opaqueShader.get());
+
+    const PaintSource sources[] = {
+        { "solid",      nullptr },
+        { "bm_opaque",  opaqueShader.get() },
+        { "bm_alpha",   alphaShader.get() },
+        { "grad2",      twoStop.get() },
+        { "gradN",      manyStop.get() },
+        { "tricolor",   &triColor },
+        { "composite",  &composite },
+    };
+
+    printf("time per span (ns), split into a fixed cost per span and a cost per pixel\n");
+    printf("%-8s %-10s", "mode", "source");
+    for (int len : kSpanLengths) {
+        printf(" %9d", len);
+    }
+    printf(" %10s %8s\n", "ns/span", "ns/px");
+
+    for (int m = 0; m < GARRAY_COUNT(kModes); ++m) {
+        for (const PaintSource& src : sources) {
+            std::string name = std::string(kModeNames[m]) + "_" + src.fName;
+            if (match && !strstr(name.c_str(), match)) {
+                continue;
+            }
+
+            GPaint paint;
+            paint.setBlendMode(kModes[m]);
+            if (src.fShader) {
+                paint.setShader(src.fShader);
+            } else {
+                paint.setColor({0.25f, 0.5f, 0.75f, 0.6f});
+            }
+
+            printf("%-8s %-10s", kModeNames[m], src.fName);
+            double perSpan[GARRAY_COUNT(kSpanLengths)];
+            for (int i = 0; i < GARRAY_COUNT(kSpanLengths); ++i) {
+                const int len = kSpanLengths[i];
+                const GRect r = GRect::XYWH(0, 0, (float)len, kRows);
+                auto draw = [&](GCanvas* canvas) {
+                    canvas->drawRect(r, paint);
+                };
+                GBenchStats stats = GRunBench(draw, (int)W, kRows, (int64_t)len * kRows, samples);
+                perSpan[i] = stats.fMedianNS / kRows;
+                printf(" %9.1f", perSpan[i]);
+                fflush(stdout);
+            }
+            const int last = GARRAY_COUNT(kSpanLengths) - 1;
+            double perPixel = (perSpan[last] - perSpan[last - 1]) /
+                              (kSpanLengths[last] - kSpanLengths[last - 1]);
+            double overhead = perSpan[0] - perPixel * kSpanLengths[0];
+            printf(" %10.1f %8.3f\n", overhead, perPixel);
+        }
+    }
+
+    free(opaqueBM.pixels());
+    free(alphaBM.pixels());
+    GSetWorkerCount(-1);
+    return 0;
+}
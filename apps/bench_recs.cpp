@@ -0,0 +1,81 @@
+#include "bench.h"
+#include "image_final.cpp"
+
+static const GBitmap& spock() {
+    // held for the whole run, so shaders made from it never dangle
+    static GImage image = GImageCache::Default().find("apps/spock.png");
+    assert(image);
+    return *image;
+}
+
+static void bench_clear(GCanvas* canvas) {
+    canvas->clear({0.5f, 0.25f, 1, 1});
+}
+
+static void bench_rect_opaque(GCanvas* canvas) {
+    canvas->drawRect({0, 0, 1024, 1024}, GPaint({1, 0, 0, 1}));
+}
+
+static void bench_rect_blend(GCanvas* canvas) {
+    canvas->drawRect({0, 0, 1024, 1024}, GPaint({0, 0, 1, 0.5f}));
+}
+
+static void bench_rect_bitmap(GCanvas* canvas) {
+    const GBitmap& bm = spock();
+    auto sh = GCreateBitmapShader(bm, GMatrix::Scale(1024.0f / bm.width(), 1024.0f / bm.height()));
+    canvas->drawRect({0, 0, 1024, 1024}, GPaint(sh.get()));
+}
+
+static void bench_rect_gradient(GCanvas* canvas) {
+    const GColor colors[] = {{1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 1}};
+    auto sh = GCreateLinearGradient({0, 0}, {1024, 1024}, colors, 3);
+    canvas->drawRect({0, 0, 1024, 1024}, GPaint(sh.get()));
+}
+
+static void bench_path_circles(GCanvas* canvas) {
+    GRandom rand;
+    GPaint paint;
+    for (int i = 0; i < 100; ++i) {
+        GPath path;
+        path.addCircle({rand.nextF() * 1024, rand.nextF() * 1024}, 10 + rand.nextF() * 90);
+        paint.setColor({rand.nextF(), rand.nextF(), rand.nextF(), 0.5f});
+        canvas->drawPath(path, paint);
+    }
+}
+
+static void bench_path_polygon(GCanvas* canvas) {
+    GRandom rand;
+    std::vector<GPoint> pts;
+    for (int i = 0; i < 10000; ++i) {
+        pts.push_back({rand.nextF() * 1024, rand.nextF() * 1024});
+    }
+    GPath path;
+    path.addPolygon(pts.data(), (int)pts.size());
+    canvas->drawPath(path, GPaint({0, 0.5f, 0, 1}));
+}
+
+static void bench_mesh_quad(GCanvas* canvas) {
+    const GPoint pts[] = {{0, 0}, {1024, 0}, {1024, 1024}, {0, 1024}};
+    const GColor colors[] = {{1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 1}, {1, 1, 1, 1}};
+    canvas->drawQuad(pts, colors, nullptr, 16, GPaint());
+}
+
+const GBenchRec gBenchRecs[] = {
+    { bench_clear,          1024, 1024, "clear",          0 },
+    { bench_rect_opaque,    1024, 1024, "rect_opaque",    0 },
+    { bench_rect_blend,     1024, 1024, "rect_blend",     0 },
+    { bench_rect_bitmap,    1024, 1024, "rect_bitmap",    0 },
+    { bench_rect_gradient,  1024, 1024, "rect_gradient",  0 },
+    { bench_path_circles,   1024, 1024, "path_circles",   0 },
+    { bench_path_polygon,   1024, 1024, "path_polygon",   0 },
+    { bench_mesh_quad,      1024, 1024, "mesh_quad",      0 },
+
+    { final_sweep,       512, 512, "final_sweep",       0 },
+    { final_coons,       512, 512, "final_coons",       0 },
+    { final_colormarix,  512, 512, "final_colormatrix", 0 },
+    { final_stroke,      512, 512, "final_stroke",      0 },
+    { final_voronoi,     512, 512, "final_voronoi",     0 },
+    { final_linearpos,   512, 512, "final_linearpos",   0 },
+
+    { nullptr, 0, 0, nullptr, 0 },
+};
@@ -0,0 +1,158 @@
+/*
+ *  Scalability sweeps over reproducible random scenes.
+ *
+ *  Each sweep varies one parameter (canvas size, path count, edges per path, rect count,
+ *  triangle count, or thread count) and holds the rest at their defaults, so that time vs.
+ *  parameter curves expose super-linear behavior that small tests never reach.
+ */
+
+#include "bench.h"
+#include "../include/GBitmap.h"
+#include "../include/GCanvas.h"
+#include "../include/GPath.h"
+#include "../include/GRandom.h"
+#include "../include/GScheduler.h"
+#include <string>
+#include <thread>
+
+struct ScaleParams {
+    int fSize = 1024;       // canvas is fSize x fSize
+    int fPaths = 16;
+    int fEdges = 64;        // per path
+    int fRects = 256;
+    int fTriangles = 256;
+    int fThreads = 1;       // including the calling thread
+};
+
+class ScaleScene {
+public:
+    ScaleScene(const ScaleParams& p) {
+        GRandom rand(p.fSize ^ (p.fPaths << 8) ^ (p.fEdges << 16) ^ p.fRects ^ p.fTriangles);
+        const float s = (float)p.fSize;
+
+        for (int i = 0; i < p.fPaths; ++i) {
+            GPath path;
+            path.moveTo(rand.nextF() * s, rand.nextF() * s);
+            for (int j = 1; j < p.fEdges; ++j) {
+                path.lineTo(rand.nextF() * s, rand.nextF() * s);
+            }
+            fPaths.push_back(path);
+        }
+
+        for (int i = 0; i < p.fRects; ++i) {
+            float x = rand.nextF() * s, y = rand.nextF() * s;
+            fRects.push_back(GRect::XYWH(x, y, rand.nextF() * s / 4, rand.nextF() * s / 4));
+        }
+
+        for (int i = 0; i < p.fTriangles; ++i) {
+            float x = rand.nextF() * s, y = rand.nextF() * s, r = s / 8;
+            for (int j = 0; j < 3; ++j) {
+                fIndices.push_back((int)fVerts.size());
+                fVerts.push_back({x + (rand.nextF() - 0.5f) * r, y + (rand.nextF() - 0.5f) * r});
+                fColors.push_back({rand.nextF(), rand.nextF(), rand.nextF(), 1});
+            }
+        }
+
+        for (int i = 0; i < 16; ++i) {
+            fPaints.push_back(GPaint({rand.nextF(), rand.nextF(), rand.nextF(), 0.5f}));
+        }
+    }
+
+    void draw(GCanvas* canvas) const {
+        canvas->clear({1, 1, 1, 1});
+        for (size_t i = 0; i < fPaths.size(); ++i) {
+            canvas->drawPath(fPaths[i], fPaints[i % fPaints.size()]);
+        }
+        for (size_t i = 0; i < fRects.size(); ++i) {
+            canvas->drawRect(fRects[i], fPaints[i % fPaints.size()]);
+        }
+        if (!fIndices.empty()) {
+            canvas->drawMesh(fVerts.data(), fColors.data(), nullptr, (int)fIndices.size() / 3,
+                             fIndices.data(), GPaint());
+        }
+    }
+
+private:
+    std::vector<GPath>  fPaths;
+    std::vector<GRect>  fRects;
+    std::vector<GPoint> fVerts;
+    std::vector<GColor> fColors;
+    std::vector<int>    fIndices;
+    std::vector<GPaint> fPaints;
+};
+
+static void run_point(FILE* csv, const char sweep[], int value, const ScaleParams& p, int samples) {
+    GSetWorkerCount(p.fThreads - 1);
+    ScaleScene scene(p);
+    GBenchStats stats = GRunBench([&scene](GCanvas* canvas) { scene.draw(canvas); },
+                                  p.fSize, p.fSize, 0, samples);
+
+    const char* fmt = "%s,%d,%d,%d,%d,%d,%d,%d,%.1f,%.1f,%.3f\n";
+    printf(fmt, sweep, value, p.fSize, p.fPaths, p.fEdges, p.fRects, p.fTriangles, p.fThreads,
+           stats.fMedianNS, stats.fP95NS, stats.fMPixPerSec);
+    fflush(stdout);
+    if (csv) {
+        fprintf(csv, fmt, sweep, value, p.fSize, p.fPaths, p.fEdges, p.fRects, p.fTriangles,
+                p.fThreads, stats.fMedianNS, stats.fP95NS, stats.fMPixPerSec);
+    }
+}
+
+int main_bench_scale(const char* csvPath, int maxSize, int samples) {
+    FILE* csv = nullptr;
+    if (csvPath) {
+        csv = fopen(csvPath, "w");
+        if (!csv) {
+            printf("------- failed to create %s\n", csvPath);
+            return -1;
+        }
+    }
+
+    const char* header = "sweep,value,size,paths,edges,rects,triangles,threads,median_ns,p95_ns,mpix_per_sec\n";
+    printf("%s", header);
+    if (csv) {
+        fprintf(csv, "%s", header);
+    }
+
+    for (int size = 256; size <= maxSize; size *= 4) {
+        ScaleParams p;
+        p.fSize = size;
+        run_point(csv, "size", size, p, samples);
+    }
+    for (int paths : {1, 4, 16, 64, 256}) {
+        ScaleParams p;
+        p.fPaths = paths;
+        run_point(csv, "paths", paths, p, samples);
+    }
+    for (int edges : {16, 256, 4096, 65536}) {
+        ScaleParams p;
+        p.fPaths = 1;
+        p.fEdges = edges;
+        run_point(csv, "edges", edges, p, samples);
+    }
+    for (int rects : {16, 256, 4096}) {
+        ScaleParams p;
+        p.fRects = rects;
+        run_point(csv, "rects", rects, p, samples);
+    }
+    for (int triangles : {16, 256, 4096}) {
+        ScaleParams p;
+        p.fTriangles = triangles;
+        run_point(csv, "triangles", triangles, p, samples);
+    }
+
+    const int maxThreads = std::max(2, (int)std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        ScaleParams p;
+        p.fSize = std::min(4096, maxSize);
+        p.fPaths = 4;
+        p.fEdges = 8192;
+        p.fThreads = threads;
+        run_point(csv, "threads", threads, p, samples);
+    }
+
+    GSetWorkerCount(-1);
+    if (csv) {
+        fclose(csv);
+    }
+    return 0;
+}
@@ -4,9 +4,20 @@
 
 #include "image.h"
 #include "../include/GCanvas.h"
+#include "../include/GOverdrawCanvas.h"
 #include "../include/GColor.h"
 #include "../include/GBitmap.h"
+#include "../include/GImageCache.h"
+#include "../include/GOwnedBitmap.h"
+#include "../include/GScheduler.h"
+#include "../include/GTime.h"
+#include "../include/GTrace.h"
 #include <string>
+#include <vector>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
 
 static int pixel_diff(GPixel p0, GPixel p1) {
     int da = abs(GPixel_GetA(p0) - GPixel_GetA(p1));
@@ -16,63 +27,168 @@ static int pixel_diff(GPixel p0, GPixel p1) {
     return std::max(da, std::max(dr, std::max(dg, db)));
 }
 
-static double compare(const GBitmap& a, const GBitmap& b, int tolerance, bool verbose) {
+#ifdef __SSE2__
+// pixel_diff() of 4 pixel pairs at once, one result in the low byte of each 32-bit lane
+static __m128i pixel_diff4(__m128i a, __m128i b) {
+    __m128i d = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+    d = _mm_max_epu8(d, _mm_srli_epi32(d, 16));
+    d = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+    return _mm_and_si128(d, _mm_set1_epi32(0xFF));
+}
+
+static int64_t sum_lanes(__m128i v) {
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, v);
+    return (int64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+#endif
+
+// Adds the over-tolerance difference of one row to *total_diff, and the pixels that count
+// (not transparent in both) to *counted.
+static void compare_row(const GPixel a[], const GPixel b[], int count, int tolerance,
+                        int64_t* total_diff, int64_t* counted) {
+    int x = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    // diffs are at most 255, so a larger tolerance zeroes them all just the same
+    const __m128i tol = _mm_set1_epi32(std::min(tolerance, 255));
+    __m128i diffs = zero;
+    __m128i skipped = zero;
+    for (; x + 4 <= count; x += 4) {
+        __m128i pa = _mm_loadu_si128((const __m128i*)(a + x));
+        __m128i pb = _mm_loadu_si128((const __m128i*)(b + x));
+        __m128i background = _mm_cmpeq_epi32(_mm_or_si128(pa, pb), zero);
+        __m128i d = _mm_subs_epu8(pixel_diff4(pa, pb), tol);
+        diffs = _mm_add_epi32(diffs, _mm_andnot_si128(background, d));
+        skipped = _mm_sub_epi32(skipped, background);   // background lanes are -1
+    }
+    *total_diff += sum_lanes(diffs);
+    *counted += x - sum_lanes(skipped);
+#endif
+    for (; x < count; ++x) {
+        // we don't score transparent pixels if both a and b are transparent (background)
+        if (!a[x] && !b[x]) {
+            continue;
+        }
+
+        int diff = pixel_diff(a[x], b[x]) - tolerance;
+        if (diff > 0) {
+            *total_diff += diff;
+        }
+        *counted += 1;
+    }
+}
+
+static double compare(const GBitmap& a, const GBitmap& b, int tolerance) {
     assert(a.width() == b.width());
     assert(a.height() == b.height());
 
-    int total = 0;
-
     const GPixel* rowA = a.pixels();
     const GPixel* rowB = b.pixels();
 
-    int total_diff = 0;
-    int max_diff = 0;
+    int64_t total_diff = 0;
+    int64_t counted = 0;
 
     for (int y = 0; y < a.height(); ++y) {
-        for (int x = 0; x < a.width(); ++x) {
-            // we don't score transparent pixels if both a and b are transparent (background)
-            if (!rowA[x] && !rowB[x]) {
-                continue;
-            }
-
-            int diff = pixel_diff(rowA[x], rowB[x]) - tolerance;
-            if (diff > 0) {
-                total_diff += diff;
-                max_diff = std::max(max_diff, diff);
-            }
-            total += 255;
-        }
+        compare_row(rowA, rowB, a.width(), tolerance, &total_diff, &counted);
         rowA = (const GPixel*)((const char*)rowA + a.rowBytes());
         rowB = (const GPixel*)((const char*)rowB + b.rowBytes());
     }
 
+    const int64_t total = counted * 255;
     double score = 1.0 * (total - total_diff) / total;
     assert(score >= 0 && score <= 1);
     score *= score;
-    if (verbose) {
-        printf(" score %3d", (int)(score * 100));
-    }
     return score;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
-static void handle_proc(const GDrawRec& rec, const char path[], GBitmap* bitmap) {
-    bitmap->alloc(rec.fWidth, rec.fHeight);
+// What running one rec produced. Recs may run concurrently, so nothing is printed or scored
+// until they are reported, in order.
+struct RecResult {
+    bool        fScored = false;    // an expected image was loaded and compared
+    double      fCorrect = 0;
+    std::string fStatus;            // follows "image: [..] name" on the verbose line
+    std::string fLog;               // lines printed after it
+    std::string fDiffHtml;
+
+    // milliseconds
+    double      fDraw = 0;
+    double      fWrite = 0;
+    double      fRead = 0;
+    double      fCompare = 0;
+};
+
+static double ms_since(GNSec start) {
+    return (GTime::GetNSec() - start) * 1e-6;
+}
 
-    auto canvas = GCreateCanvas(*bitmap);
+// Describes the overdraw ratio and histogram, and writes the heatmap into dir.
+static std::string report_overdraw(const GOverdrawCanvas& canvas, const char dir[], const char name[]) {
+    uint64_t histogram[9];
+    canvas.histogram(histogram, GARRAY_COUNT(histogram));
+
+    char line[256];
+    snprintf(line, sizeof(line), "overdraw: %-24s ratio %6.3f  writes 0..8+:", name,
+             canvas.overdrawRatio());
+    std::string report(line);
+    for (uint64_t n : histogram) {
+        snprintf(line, sizeof(line), " %llu", (unsigned long long)n);
+        report += line;
+    }
+    report += "\n";
+
+    std::string path(dir);
+    path += "/";
+    path += name;
+    path += "_overdraw.png";
+    if (!canvas.writeHeatmap(path.c_str())) {
+        fprintf(stderr, "failed to write %s\n", path.c_str());
+    }
+    return report;
+}
+
+static void handle_proc(const GDrawRec& rec, const char path[], GOwnedBitmap* bitmap,
+                        const char overdrawDir[], const GBitmap::PNGOptions& pngOpts,
+                        RecResult* result) {
+    // the clear below writes every pixel
+    *bitmap = GOwnedBitmap(rec.fWidth, rec.fHeight, GOwnedBitmap::kUninitialized_Init);
+
+    std::unique_ptr<GCanvas> canvas;
+    GOverdrawCanvas* overdraw = nullptr;
+    if (overdrawDir) {
+        auto counting = GCreateOverdrawCanvas(*bitmap);
+        overdraw = counting.get();
+        canvas = std::move(counting);
+    } else {
+        // the rec draws only through the canvas, which is flushed before the bitmap is written
+        canvas = GCreateDeferredCanvas(*bitmap);
+    }
     if (!canvas) {
         fprintf(stderr, "failed to create canvas for [%d %d] %s\n",
                 rec.fWidth, rec.fHeight, rec.fName);
         return;
     }
 
+    GNSec start = GTime::GetNSec();
     canvas->clear({0, 0, 0, 0});
+    if (overdraw) {
+        // the harness's own clear is not part of the scene
+        overdraw->resetCounts();
+    }
     rec.fDraw(canvas.get());
+    canvas->flush();
+    result->fDraw = ms_since(start);
+    if (overdraw) {
+        result->fLog += report_overdraw(*overdraw, overdrawDir, rec.fName);
+    }
 
-    if (!bitmap->writeToFile(path)) {
+    start = GTime::GetNSec();
+    if (!bitmap->bitmap().writeToFile(path, pngOpts)) {
         fprintf(stderr, "failed to write %s\n", path);
     }
+    result->fWrite = ms_since(start);
 }
 
 static bool is_arg(const char arg[], const char name[]) {
@@ -89,44 +205,66 @@ static bool is_arg(const char arg[], const char name[]) {
     return !strcmp(arg, shortVers);
 }
 
-static void add_image(FILE* f, const char path[], const char name[], const char suffix[],
-                      const GBitmap& bm) {
+// Writes bm into path and returns the html that shows it.
+static std::string add_image(const char path[], const char name[], const char suffix[],
+                             const GBitmap& bm) {
     std::string str(name);
     str += "__";
     str += suffix;
     str += ".png";
-    fprintf(f, "<a href=\"%s\"><img src=\"%s\" /></a>\n", str.c_str(), str.c_str());
 
     std::string full(path);
     full += "/";
     full += str;
     bm.writeToFile(full.c_str());
+
+    return "<a href=\"" + str + "\"><img src=\"" + str + "\" /></a>\n";
 }
 
-static void add_diff_to_file(FILE* f, const GBitmap& test, const GBitmap& orig, const char path[],
-                             const char name[]) {
+static std::string add_diff_to_file(const GBitmap& test, const GBitmap& orig, const char path[],
+                                    const char name[]) {
     const int w = test.width();
     const int h = test.height();
-    GBitmap diff0, diff1;
-    diff0.alloc(w, h);
-    diff1.alloc(w, h);
+    GOwnedBitmap diff0(w, h, GOwnedBitmap::kUninitialized_Init);
+    GOwnedBitmap diff1(w, h, GOwnedBitmap::kUninitialized_Init);
 
     for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            int diff = pixel_diff(*test.getAddr(x, y), *orig.getAddr(x, y));
-            *diff0.getAddr(x, y) = GPixel_PackARGB(0xFF, diff, diff, diff);
+        const GPixel* rowT = test.getAddr(0, y);
+        const GPixel* rowO = orig.getAddr(0, y);
+        GPixel* row0 = diff0.bitmap().getAddr(0, y);
+        GPixel* row1 = diff1.bitmap().getAddr(0, y);
+        int x = 0;
+#ifdef __SSE2__
+        const __m128i opaque = _mm_set1_epi32(0xFF000000);
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 4 <= w; x += 4) {
+            __m128i d = pixel_diff4(_mm_loadu_si128((const __m128i*)(rowT + x)),
+                                    _mm_loadu_si128((const __m128i*)(rowO + x)));
+            __m128i gray = _mm_or_si128(d, _mm_or_si128(_mm_slli_epi32(d, 8),
+                                                        _mm_slli_epi32(d, 16)));
+            __m128i same = _mm_cmpeq_epi32(d, zero);
+            _mm_storeu_si128((__m128i*)(row0 + x), _mm_or_si128(opaque, gray));
+            __m128i differs = _mm_andnot_si128(same, _mm_set1_epi32(-1));
+            _mm_storeu_si128((__m128i*)(row1 + x), _mm_or_si128(opaque, differs));
+        }
+#endif
+        for (; x < w; ++x) {
+            int diff = pixel_diff(rowT[x], rowO[x]);
+            row0[x] = GPixel_PackARGB(0xFF, diff, diff, diff);
             if (diff > 0) {
                 diff = 0xFF;
             }
-            *diff1.getAddr(x, y) = GPixel_PackARGB(0xFF, diff, diff, diff);
+            row1[x] = GPixel_PackARGB(0xFF, diff, diff, diff);
         }
     }
 
-    fprintf(f, "%s<br/>\n", name);
-    add_image(f, path, name, "test", test); fprintf(f, "&nbsp;&nbsp;");
-    add_image(f, path, name, "orig", orig); fprintf(f, "&nbsp;&nbsp;");
-    add_image(f, path, name, "dif0", diff0); fprintf(f, "&nbsp;&nbsp;");
-    add_image(f, path, name, "dif1", diff1); fprintf(f, "<br><br>\n");
+    std::string html(name);
+    html += "<br/>\n";
+    html += add_image(path, name, "test", test); html += "&nbsp;&nbsp;";
+    html += add_image(path, name, "orig", orig); html += "&nbsp;&nbsp;";
+    html += add_image(path, name, "dif0", diff0); html += "&nbsp;&nbsp;";
+    html += add_image(path, name, "dif1", diff1); html += "<br><br>\n";
+    return html;
 }
 
 static int gPACounts[10] = { 0,0,0,0,0,0,0,0,0,0 };
@@ -147,8 +285,14 @@ int main_image(int argc, const char* argv[]) {
     const char* expected = NULL;
     const char* diffDir = NULL;
     const char* scoreFile = nullptr;
+    const char* traceFile = nullptr;
+    const char* overdrawDir = nullptr;
+    GBitmap::PNGOptions pngOpts;
+    const char* outputExt = ".png";
     FILE* diffFile = NULL;
     int tolerance = 0;
+    int jobs = 0;           // 0: one rec at a time, printing as it goes
+    bool timings = false;
 
     const char* collage_dir = nullptr;
     int collage_index = -1;
@@ -174,6 +318,29 @@ int main_image(int argc, const char* argv[]) {
             assert(tolerance >= 0);
         } else if (is_arg(argv[i], "scoreFile") && i+1 < argc) {
             scoreFile = argv[++i];
+        } else if (!strcmp(argv[i], "--jobs") && i+1 < argc) {
+            jobs = atoi(argv[++i]);
+            assert(jobs >= 0);
+        } else if (!strcmp(argv[i], "--fast-png")) {
+            // bigger files, much faster to write
+            pngOpts = GBitmap::PNGOptions::Fast();
+        } else if (!strcmp(argv[i], "--qoi")) {
+            // writeToFile() picks the format from the extension
+            outputExt = ".qoi";
+        } else if (!strcmp(argv[i], "--timings")) {
+            timings = true;
+        } else if (!strcmp(argv[i], "--overdraw") && i+1 < argc) {
+            overdrawDir = argv[++i];
+        } else if ((!strcmp(argv[i], "--trace") || !strcmp(argv[i], "--trace-spans")) &&
+                   !GTraceIsCompiledIn()) {
+            printf("------- %s needs tracing compiled in (make image CPPFLAGS=-DG_TRACE)\n", argv[i]);
+            return -1;
+        } else if (!strcmp(argv[i], "--trace") && i+1 < argc) {
+            traceFile = argv[++i];
+            GTraceSetLevel(GTraceLevel::kDraws);
+        } else if (!strcmp(argv[i], "--trace-spans") && i+1 < argc) {
+            traceFile = argv[++i];
+            GTraceSetLevel(GTraceLevel::kSpans);
         } else if (is_arg(argv[i], "diff") && i+1 < argc) {
             diffDir = argv[++i];
             std::string path(diffDir);
@@ -201,6 +368,74 @@ int main_image(int argc, const char* argv[]) {
     // pa#_NAME.png -- so add 8 to the name length for the total
     const int maxNameLen = max_name_len() + 8;
 
+    std::vector<RecResult> results(gDrawCount);
+
+    // Everything one rec needs that doesn't touch shared state, so recs can run concurrently.
+    auto run = [&](int i) {
+        const GDrawRec& rec = gDrawRecs[i];
+        RecResult* result = &results[i];
+
+        std::string path(root);
+        path += rec.fName;
+        path += outputExt;
+
+        GOwnedBitmap testBM;
+        handle_proc(rec, path.c_str(), &testBM, overdrawDir, pngOpts, result);
+
+        bool something = strncmp(rec.fName, "something_", strlen("something_")) == 0;
+        if (expected && !something) {
+            std::string exp_path(expected);
+            exp_path += "/";
+            exp_path += rec.fName;
+            exp_path += ".png";
+            GBitmap expectedBM;
+
+            GNSec start = GTime::GetNSec();
+            bool loaded = expectedBM.readFromFile(exp_path.c_str());
+            result->fRead = ms_since(start);
+            if (!loaded) {
+                result->fStatus = "- failed to load <" + exp_path + ">";
+            } else {
+                start = GTime::GetNSec();
+                result->fCorrect = compare(testBM, expectedBM, tolerance);
+                result->fCompare = ms_since(start);
+                result->fScored = true;
+                if (verbose) {
+                    char score[16];
+                    snprintf(score, sizeof(score), " score %3d", (int)(result->fCorrect * 100));
+                    result->fStatus = score;
+                }
+                if (result->fCorrect < 1 && diffFile != NULL) {
+                    result->fDiffHtml = add_diff_to_file(testBM, expectedBM, diffDir, rec.fName);
+                }
+                free(expectedBM.pixels());
+            }
+        }
+    };
+
+    auto selected = [&](int i) {
+        if (!match) {
+            return true;
+        }
+        std::string path(root);
+        path += gDrawRecs[i].fName;
+        path += outputExt;
+        return strstr(path.c_str(), match) != nullptr;
+    };
+
+    GNSec wallStart = GTime::GetNSec();
+    if (jobs > 0) {
+        GSetWorkerCount(jobs - 1);
+        GParallelFor(0, gDrawCount, 1, [&](int start, int stop) {
+            for (int i = start; i < stop; ++i) {
+                if (selected(i)) {
+                    run(i);
+                }
+            }
+        });
+    }
+
+    // Scores are summed in rec order, whatever order the recs ran in, so they don't vary by a bit.
     double percent_correct = 0;
     double counter = 0;
     int numImages = 0;
@@ -212,53 +447,71 @@ int main_image(int argc, const char* argv[]) {
 
         std::string path(root);
         path += gDrawRecs[i].fName;
-        path += ".png";
+        path += outputExt;
 
         bool something = strncmp(gDrawRecs[i].fName, "something_", strlen("something_")) == 0;
         if (!something) {
             counter += weight;
         }
 
-        if (match && !strstr(path.c_str(), match)) {
+        if (!selected(i)) {
             continue;
         }
 
         if (verbose && !something) {
             printf("image: [%2d] %*s", i, maxNameLen, path.c_str());
+            fflush(stdout);
+        }
+        if (jobs <= 0) {
+            run(i);
         }
-        
-        GBitmap testBM;
-        handle_proc(gDrawRecs[i], path.c_str(), &testBM);
-
-        if (expected && !something) {
-            std::string exp_path(expected);
-            exp_path += "/";
-            exp_path += gDrawRecs[i].fName;
-            exp_path += ".png";
-            GBitmap expectedBM;
-    
-            if (!expectedBM.readFromFile(exp_path.c_str())) {
-                printf("- failed to load <%s>", exp_path.c_str());
-            } else {
-                double correct = compare(testBM, expectedBM, tolerance, verbose);
-                if (correct < 1 && diffFile != NULL) {
-                    add_diff_to_file(diffFile, testBM, expectedBM, diffDir, gDrawRecs[i].fName);
-                }
-                double individual_score = correct * weight;
 
-                percent_correct += individual_score;
-            }
+        const RecResult& result = results[i];
+        printf("%s", result.fStatus.c_str());
+        if (result.fScored) {
+            percent_correct += result.fCorrect * weight;
+        }
+        if (!result.fDiffHtml.empty()) {
+            fputs(result.fDiffHtml.c_str(), diffFile);
         }
 
         if (verbose && !something) {
             printf("\n");
         }
+        printf("%s", result.fLog.c_str());
+    }
+    double wallTime = ms_since(wallStart);
 
-        free(testBM.pixels());
+    if (timings) {
+        printf("%*s %9s %9s %9s %9s\n", maxNameLen, "ms", "draw", "write", "read", "compare");
+        RecResult sum;
+        for (int i = 0; gDrawRecs[i].fDraw; ++i) {
+            if (!selected(i)) {
+                continue;
+            }
+            const RecResult& r = results[i];
+            printf("%*s %9.2f %9.2f %9.2f %9.2f\n", maxNameLen, gDrawRecs[i].fName,
+                   r.fDraw, r.fWrite, r.fRead, r.fCompare);
+            sum.fDraw += r.fDraw;
+            sum.fWrite += r.fWrite;
+            sum.fRead += r.fRead;
+            sum.fCompare += r.fCompare;
+        }
+        printf("%*s %9.2f %9.2f %9.2f %9.2f\n", maxNameLen, "total",
+               sum.fDraw, sum.fWrite, sum.fRead, sum.fCompare);
+        printf("%*s %9.2f  (%d jobs)\n", maxNameLen, "wall", wallTime,
+               jobs > 0 ? jobs : 1);
+        GImageCache::Stats cache = GImageCache::Default().stats();
+        printf("image cache: %llu hits, %llu decodes, %llu waited\n",
+               (unsigned long long)cache.fHits, (unsigned long long)cache.fMisses,
+               (unsigned long long)cache.fWaits);
     }
     if (diffFile) {
         fclose(diffFile);
     }
+    if (traceFile && !GTraceWriteFile(traceFile)) {
+        printf("------- failed to write trace %s\n", traceFile);
+    }
 
     constexpr double num_required = 2;
 
@@ -8,6 +8,7 @@
 #include "../include/GCanvas.h"
 #include "../include/GBitmap.h"
 #include "../include/GColor.h"
+#include "../include/GImageCache.h"
 #include "../include/GMatrix.h"
 #include "../include/GPath.h"
 #include "../include/GPoint.h"
@@ -63,10 +64,9 @@ static void final_sweep(GCanvas* canvas) {
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 static void final_coons(GCanvas* canvas) {
-    GBitmap bm;
-    bm.readFromFile("apps/spock.png");
-    assert(bm.width());
-    assert(bm.height());
+    GImage spock = GImageCache::Default().find("apps/spock.png");
+    assert(spock);
+    const GBitmap& bm = *spock;
 
     GPoint pts[] = {
         {0, 0}, {0.25f, 0.5}, {1, 0},
@@ -118,11 +118,8 @@ static void draw_cm(GFinal* f, GCanvas* canvas, const GRect& r, const GColorMatr
     }
 }
 
-static std::unique_ptr<GShader> make_bm_shader(const char path[], float w, float h) {
-    GBitmap bm;
-    bm.readFromFile(path);
-    assert(bm.width());
-    assert(bm.height());
+// The shader refers to bm's pixels, so bm must outlive it.
+static std::unique_ptr<GShader> make_bm_shader(const GBitmap& bm, float w, float h) {
     return GCreateBitmapShader(bm, GMatrix::Scale(w/bm.width(), h/bm.height()));
 }
 
@@ -133,8 +130,11 @@ static void final_colormarix(GCanvas* canvas) {
     const GRect r = {0, 0, W, H};
 
     const GColor colors[] = {{1,0,0,1}, {0,1,0,0}, {0,0,1,1}};
-    auto sh0 = make_bm_shader("apps/spock.png", W, H);
-    auto sh1 = make_bm_shader("apps/wheel.png", W, H);
+    GImage spock = GImageCache::Default().find("apps/spock.png");
+    GImage wheel = GImageCache::Default().find("apps/wheel.png");
+    assert(spock && wheel);
+    auto sh0 = make_bm_shader(*spock, W, H);
+    auto sh1 = make_bm_shader(*wheel, W, H);
     auto sh2 = GCreateLinearGradient({0, 0}, {W, H}, colors, 3);
     GShader* const shaders[] = {sh0.get(), sh1.get(), sh2.get()};
 
@@ -0,0 +1,7 @@
+#include <stdio.h>
+
+extern int main_bench(int argc, const char* argv[]);
+
+int main(int argc, const char* argv[]) {
+    return main_bench(argc, argv);
+}
@@ -0,0 +1,33 @@
+#include "tests.h"
+#include "../include/GScheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main_tests(int argc, const char* argv[]) {
+    const char* match = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--match") && i+1 < argc) {
+            match = argv[++i];
+        } else if (!strcmp(argv[i], "--workers") && i+1 < argc) {
+            GSetWorkerCount(atoi(argv[++i]));
+        } else {
+            printf("usage: tests [--match substring] [--workers count]\n");
+            return -1;
+        }
+    }
+
+    int run = 0;
+    int failed = 0;
+    for (int i = 0; gTestRecs[i].fProc; ++i) {
+        if (match && !strstr(gTestRecs[i].fName, match)) {
+            continue;
+        }
+        bool ok = gTestRecs[i].fProc();
+        printf("%-24s %s\n", gTestRecs[i].fName, ok ? "ok" : "FAILED");
+        run += 1;
+        failed += !ok;
+    }
+    printf("------- %d of %d tests failed\n", failed, run);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,15 @@
+#ifndef G_tests_DEFINED
+#define G_tests_DEFINED
+
+struct GTestRec {
+    // returns false after printing what went wrong
+    bool        (*fProc)();
+    const char* fName;
+};
+
+/*
+ *  Array is terminated when fProc is NULL
+ */
+extern const GTestRec gTestRecs[];
+
+#endif
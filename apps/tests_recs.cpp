@@ -0,0 +1,825 @@
+/*
+ *  Randomized checks of the library against simple models of what it should compute.
+ *
+ *  Each test builds its inputs from a fixed GRandom seed, so a failure reproduces exactly.
+ */
+
+#include "tests.h"
+#include "../include/GArena.h"
+#include "../include/GCanvas.h"
+#include "../include/GImageCache.h"
+#include "../include/GOwnedBitmap.h"
+#include "../include/GPath.h"
+#include "../include/GPicture.h"
+#include "../include/GRandom.h"
+#include "../include/GRegion.h"
+#include "../include/GScene.h"
+#include "../include/GShader.h"
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// GRegion, against a grid of one bool per pixel
+
+// Regions are built from rects inside [kGridMin, kGridMin + kGridSize), so a grid that size holds
+// all of them.
+static const int kGridMin = -5;
+static const int kGridSize = 45;
+
+class PixelGrid {
+public:
+    PixelGrid() : fBits(kGridSize * kGridSize, false) {}
+
+    explicit PixelGrid(const GRegion& rgn) : PixelGrid() {
+        for (int y = kGridMin; y < kGridMin + kGridSize; y++) {
+            for (int x = kGridMin; x < kGridMin + kGridSize; x++) {
+                this->set(x, y, rgn.contains(x, y));
+            }
+        }
+    }
+
+    bool get(int x, int y) const {
+        return x >= kGridMin && x < kGridMin + kGridSize && y >= kGridMin && y < kGridMin + kGridSize &&
+               fBits[(y - kGridMin) * kGridSize + (x - kGridMin)];
+    }
+    void set(int x, int y, bool in) { fBits[(y - kGridMin) * kGridSize + (x - kGridMin)] = in; }
+
+    bool operator==(const PixelGrid& other) const { return fBits == other.fBits; }
+
+private:
+    std::vector<bool> fBits;
+};
+
+// may be empty
+static GIRect random_rect(GRandom& rand) {
+    int left = rand.nextRange(kGridMin, kGridMin + 29);
+    int top = rand.nextRange(kGridMin, kGridMin + 29);
+    return GIRect::LTRB(left, top, left + rand.nextRange(0, 14), top + rand.nextRange(0, 14));
+}
+
+static GRegion random_region(GRandom& rand) {
+    GRegion rgn(random_rect(rand));
+    for (int i = rand.nextRange(0, 4); i > 0; i--) {
+        rgn.op(random_rect(rand), (GRegion::Op)rand.nextRange(0, 2));
+    }
+    return rgn;
+}
+
+// Whether rgn's rects tile exactly the pixels of grid, in canonical form: bands top to bottom,
+// each with spans left to right and gaps between them, and no band with the same spans as the
+// band it touches above it.
+static bool check_rects(const GRegion& rgn, const PixelGrid& grid) {
+    struct Band {
+        int fTop, fBottom;
+        std::vector<std::pair<int, int>> fSpans;
+    };
+    std::vector<Band> bands;
+    PixelGrid covered;
+    bool ok = true;
+    rgn.forEachRect([&](const GIRect& r) {
+        ok = ok && !r.isEmpty();
+        if (bands.empty() || r.top != bands.back().fTop) {
+            ok = ok && (bands.empty() || r.top >= bands.back().fBottom);
+            bands.push_back({r.top, r.bottom, {}});
+        }
+        Band& band = bands.back();
+        ok = ok && r.bottom == band.fBottom && (band.fSpans.empty() || r.left > band.fSpans.back().second);
+        band.fSpans.push_back({r.left, r.right});
+        for (int y = r.top; y < r.bottom; y++) {
+            for (int x = r.left; x < r.right; x++) {
+                ok = ok && !covered.get(x, y);
+                covered.set(x, y, true);
+            }
+        }
+    });
+    for (size_t i = 1; i < bands.size(); i++) {
+        ok = ok && !(bands[i].fTop == bands[i - 1].fBottom && bands[i].fSpans == bands[i - 1].fSpans);
+    }
+    return ok && covered == grid;
+}
+
+static bool test_region() {
+    GRandom rand(1);
+    for (int iter = 0; iter < 20000; iter++) {
+        GRegion a = random_region(rand);
+        GRegion b = random_region(rand);
+        PixelGrid ga(a), gb(b);
+        if (!check_rects(a, ga)) {
+            printf("  iteration %d: rects do not match the pixels, or are not canonical\n", iter);
+            return false;
+        }
+
+        const GRegion::Op op = (GRegion::Op)rand.nextRange(0, 2);
+        GRegion c = a;
+        c.op(b, op);
+        PixelGrid expected;
+        GIRect bounds = GIRect::LTRB(0, 0, 0, 0);
+        bool any = false;
+        for (int y = kGridMin; y < kGridMin + kGridSize; y++) {
+            for (int x = kGridMin; x < kGridMin + kGridSize; x++) {
+                bool in = op == GRegion::kUnion_Op ? ga.get(x, y) || gb.get(x, y)
+                        : op == GRegion::kIntersect_Op ? ga.get(x, y) && gb.get(x, y)
+                        : ga.get(x, y) && !gb.get(x, y);
+                expected.set(x, y, in);
+                if (in) {
+                    bounds = any ? GIRect::LTRB(std::min(bounds.left, x), std::min(bounds.top, y),
+                                                std::max(bounds.right, x + 1), std::max(bounds.bottom, y + 1))
+                                 : GIRect::LTRB(x, y, x + 1, y + 1);
+                    any = true;
+                }
+            }
+        }
+        if (!(PixelGrid(c) == expected) || !check_rects(c, expected)) {
+            printf("  iteration %d: op %d does not match the pixels\n", iter, op);
+            return false;
+        }
+        const GIRect& cb = c.bounds();
+        if (c.isEmpty() == any || cb.left != bounds.left || cb.top != bounds.top ||
+            cb.right != bounds.right || cb.bottom != bounds.bottom) {
+            printf("  iteration %d: bounds are not tight\n", iter);
+            return false;
+        }
+
+        // contains() and intersects() of a rect
+        const GIRect q = random_rect(rand);
+        bool contains = !q.isEmpty(), intersects = false;
+        for (int y = q.top; y < q.bottom; y++) {
+            for (int x = q.left; x < q.right; x++) {
+                contains = contains && expected.get(x, y);
+                intersects = intersects || expected.get(x, y);
+            }
+        }
+        if (contains != c.contains(q) || intersects != c.intersects(q)) {
+            printf("  iteration %d: contains/intersects disagree with the pixels\n", iter);
+            return false;
+        }
+
+        // the same pixels built row by row, one span per pixel, come out equal
+        GRegion::Builder builder;
+        for (int y = kGridMin; y < kGridMin + kGridSize; y++) {
+            std::vector<GRegion::Span> row;
+            for (int x = kGridMin; x < kGridMin + kGridSize; x++) {
+                if (expected.get(x, y)) {
+                    row.push_back({x, x + 1});
+                }
+            }
+            builder.addRow(y, row.data(), (int)row.size());
+        }
+        if (builder.detach() != c) {
+            printf("  iteration %d: the builder's region differs\n", iter);
+            return false;
+        }
+
+        // forEachSpan() clips to [L, R)
+        const int y = rand.nextRange(kGridMin, kGridMin + kGridSize - 1);
+        const int L = rand.nextRange(kGridMin, kGridMin + kGridSize - 1);
+        const int R = L + rand.nextRange(0, 19);
+        std::vector<bool> row(kGridSize + 20, false);
+        c.forEachSpan(L, R, y, [&](int left, int right) {
+            for (int x = left; x < right; x++) {
+                row[x - kGridMin] = true;
+            }
+        });
+        for (int x = kGridMin; x < kGridMin + kGridSize + 20; x++) {
+            if (row[x - kGridMin] != (x >= L && x < R && expected.get(x, y))) {
+                printf("  iteration %d: forEachSpan disagrees with the pixels\n", iter);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Redrawing only what changed, against drawing everything
+
+static int count_differing_rows(const GBitmap& a, const GBitmap& b) {
+    int rows = 0;
+    for (int y = 0; y < a.height(); y++) {
+        rows += memcmp(a.getAddr(0, y), b.getAddr(0, y), a.width() * sizeof(GPixel)) != 0;
+    }
+    return rows;
+}
+
+struct Widget {
+    GRect fRect;
+    GColor fColor;
+    int fKind;      // rect, circle or triangle
+    float fRadians;
+};
+
+static void draw_widget(GCanvas* canvas, const Widget& w) {
+    const GPaint paint(w.fColor);
+    const GRect local = GRect::WH(w.fRect.width(), w.fRect.height());
+    canvas->save();
+    canvas->translate(w.fRect.left, w.fRect.top);
+    canvas->rotate(w.fRadians);
+    if (w.fKind == 0) {
+        canvas->drawRect(local, paint);
+    } else if (w.fKind == 1) {
+        GPath path;
+        path.addCircle({local.width() / 2, local.height() / 2}, local.width() / 2);
+        canvas->drawPath(path, paint);
+    } else {
+        const GPoint pts[] = {{0, 0}, {local.width(), 0}, {0, local.height()}};
+        canvas->drawConvexPolygon(pts, 3, paint);
+    }
+    canvas->restore();
+}
+
+static std::unique_ptr<GPicture> record_widgets(const std::vector<Widget>& widgets) {
+    GPictureRecorder recorder;
+    recorder.canvas()->clear({1, 1, 1, 1});
+    for (const Widget& w : widgets) {
+        draw_widget(recorder.canvas(), w);
+    }
+    return recorder.finish();
+}
+
+// A frame repainted by replaying the picture clipped to the damage of the widgets that moved
+// is byte-for-byte the frame a full replay draws, and nothing outside the damage is touched.
+static bool test_picture_damage() {
+    const int W = 640, H = 480;
+    GRandom rand(7);
+    std::vector<Widget> widgets;
+    for (int i = 0; i < 300; i++) {
+        const float x = rand.nextF() * W, y = rand.nextF() * H, size = 5 + rand.nextF() * 60;
+        widgets.push_back({GRect::XYWH(x, y, size, size * 0.7f),
+                           {rand.nextF(), rand.nextF(), rand.nextF(), 0.3f + 0.7f * rand.nextF()},
+                           rand.nextRange(0, 2), rand.nextF() < 0.3f ? rand.nextF() : 0});
+    }
+
+    GOwnedBitmap frame(W, H), full(W, H), scratch(W, H);
+    auto canvas = GCreateCanvas(frame.bitmap());
+    record_widgets(widgets)->playback(canvas.get());
+    canvas->flush();
+
+    for (int iter = 0; iter < 50; iter++) {
+        // the damage is what the changed widgets cover, before and after
+        auto damageCanvas = GCreateCanvas(scratch.bitmap());
+        for (int k = 0; k <= iter % 4; k++) {
+            Widget& w = widgets[rand.nextRange(0, (int)widgets.size() - 1)];
+            draw_widget(damageCanvas.get(), w);
+            w.fRect = w.fRect.offset(rand.nextF() * 40 - 20, rand.nextF() * 40 - 20);
+            w.fColor.r = rand.nextF();
+            draw_widget(damageCanvas.get(), w);
+        }
+        GRegion damage;
+        if (!damageCanvas->getDamage(&damage)) {
+            printf("  the canvas does not track damage\n");
+            return false;
+        }
+
+        auto picture = record_widgets(widgets);
+        canvas->resetDamage();
+        picture->playback(canvas.get(), damage);
+        canvas->flush();
+        GRegion drawn;
+        canvas->getDamage(&drawn);
+        drawn.op(damage, GRegion::kDifference_Op);
+        if (!drawn.isEmpty()) {
+            printf("  iteration %d: the clipped replay drew outside the damage\n", iter);
+            return false;
+        }
+
+        auto fullCanvas = GCreateCanvas(full.bitmap());
+        picture->playback(fullCanvas.get());
+        fullCanvas->flush();
+        if (int rows = count_differing_rows(frame.bitmap(), full.bitmap())) {
+            printf("  iteration %d: %d rows differ from a full replay\n", iter, rows);
+            return false;
+        }
+    }
+    return true;
+}
+
+struct SceneNode {
+    int fKind;      // rect, circle path or two-triangle mesh
+    GRect fRect;
+    GColor fColor;
+    GMatrix fMatrix;
+    GShader* fShader;
+};
+
+static GPath circle_in(const GRect& r) {
+    GPath path;
+    path.addCircle({(r.left + r.right) / 2, (r.top + r.bottom) / 2}, r.width() / 2);
+    return path;
+}
+
+static GPaint scene_paint(const SceneNode& n) {
+    GPaint paint(n.fColor);
+    paint.setShader(n.fShader);
+    return paint;
+}
+
+static GScene::ID add_scene_node(GScene& scene, const SceneNode& n) {
+    if (n.fKind == 0) {
+        return scene.addRect(n.fRect, scene_paint(n), n.fMatrix);
+    }
+    if (n.fKind == 1) {
+        return scene.addPath(circle_in(n.fRect), scene_paint(n), n.fMatrix);
+    }
+    const GRect& r = n.fRect;
+    const GPoint verts[] = {{r.left, r.top}, {r.right, r.top}, {r.right, r.bottom}, {r.left, r.bottom}};
+    const GColor colors[] = {n.fColor, {1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 0.5f}};
+    const int indices[] = {0, 1, 3, 1, 2, 3};
+    return scene.addMesh(verts, colors, nullptr, 2, indices, GPaint(), n.fMatrix);
+}
+
+// A scene repainted tile by tile as its nodes change, including shaded ones, is byte-for-byte the
+// bitmap a fresh scene of the same nodes paints all at once.
+static bool test_scene() {
+    const int W = 800, H = 600;
+    const GColor gradientColors[] = {{1, 0, 0, 1}, {0, 0, 1, 1}};
+    auto gradient = GCreateLinearGradient({0, 0}, {W, H}, gradientColors, 2);
+
+    GRandom rand(11);
+    auto random_node = [&]() {
+        SceneNode n;
+        n.fKind = rand.nextRange(0, 2);
+        const float size = 4 + rand.nextF() * 80;
+        n.fRect = GRect::WH(size, size * 0.6f);
+        n.fColor = {rand.nextF(), rand.nextF(), rand.nextF(), 0.4f + 0.6f * rand.nextF()};
+        n.fMatrix = GMatrix::Translate(rand.nextF() * W, rand.nextF() * H);
+        if (rand.nextF() < 0.3f) {
+            n.fMatrix = n.fMatrix * GMatrix::Rotate(rand.nextF() * 3);
+        }
+        n.fShader = rand.nextF() < 0.2f ? gradient.get() : nullptr;
+        return n;
+    };
+
+    GOwnedBitmap incremental(W, H), reference(W, H);
+    GScene scene(incremental.bitmap(), {1, 1, 1, 1});
+    std::map<GScene::ID, SceneNode> live;
+    for (int i = 0; i < 2000; i++) {
+        SceneNode n = random_node();
+        live[add_scene_node(scene, n)] = n;
+    }
+    scene.render();
+
+    for (int iter = 0; iter < 200; iter++) {
+        auto it = live.begin();
+        std::advance(it, rand.nextRange(0, (int)live.size() - 1));
+        const GScene::ID id = it->first;
+        SceneNode& n = it->second;
+        switch (iter % 5) {
+            case 0:
+                n.fMatrix = GMatrix::Translate(rand.nextF() * 30 - 15, rand.nextF() * 30 - 15) * n.fMatrix;
+                scene.setMatrix(id, n.fMatrix);
+                break;
+            case 1:
+                // a mesh's colors are not in its paint, so it is only repainted
+                if (n.fKind == 2) {
+                    scene.invalidate(id);
+                } else {
+                    n.fColor.r = rand.nextF();
+                    scene.setPaint(id, scene_paint(n));
+                }
+                break;
+            case 2:
+                n.fRect.right += 5;
+                if (n.fKind == 0) {
+                    scene.setRect(id, n.fRect);
+                } else if (n.fKind == 1) {
+                    scene.setPath(id, circle_in(n.fRect));
+                } else {
+                    n.fRect.right -= 5;
+                    scene.invalidate(id);
+                }
+                break;
+            case 3:
+                scene.remove(id);
+                live.erase(id);
+                break;
+            case 4: {
+                SceneNode added = random_node();
+                live[add_scene_node(scene, added)] = added;
+                break;
+            }
+        }
+        scene.render();
+
+        if (iter % 10 == 9) {
+            GScene full(reference.bitmap(), {1, 1, 1, 1});
+            for (const auto& entry : live) {
+                add_scene_node(full, entry.second);
+            }
+            full.render();
+            if (int rows = count_differing_rows(incremental.bitmap(), reference.bitmap())) {
+                printf("  iteration %d: %d rows differ from a full render\n", iter, rows);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Clipping, against drawing the clip's shape
+
+static GPaint random_paint(GRandom& rand) {
+    GPaint paint({rand.nextF(), rand.nextF(), rand.nextF(), 0.2f + 0.8f * rand.nextF()});
+    paint.setBlendMode((GBlendMode)rand.nextRange(0, 11));
+    return paint;
+}
+
+// Filling through a clip covers exactly the pixels drawing the clip's shape would, so it is
+// byte-for-byte the same bitmap: a circle clipPath() against drawPath() of the circle, and a
+// rotated clipRect() against a rotated drawRect(). restore() must drop the clip again, which the
+// unclipped draw after it checks.
+static bool test_clip() {
+    const int W = 301, H = 203;
+    GRandom rand(13);
+    GOwnedBitmap clipped(W, H), drawn(W, H);
+
+    for (int iter = 0; iter < 200; iter++) {
+        auto clipCanvas = GCreateCanvas(clipped.bitmap());
+        auto drawCanvas = GCreateCanvas(drawn.bitmap());
+        const GColor background = {rand.nextF(), rand.nextF(), rand.nextF(), rand.nextF()};
+        clipCanvas->clear(background);
+        drawCanvas->clear(background);
+
+        const GPaint paint = random_paint(rand);
+        const GPoint center = {rand.nextF() * W, rand.nextF() * H};
+        if (iter % 2 == 0) {
+            GPath circle;
+            circle.addCircle(center, 2 + rand.nextF() * W / 2);
+            clipCanvas->save();
+            clipCanvas->clipPath(circle);
+            clipCanvas->drawRect(GRect::WH(W, H), paint);
+            clipCanvas->restore();
+            drawCanvas->drawPath(circle, paint);
+        } else {
+            const GRect r = GRect::XYWH(-rand.nextF() * 60, -rand.nextF() * 60, 1 + rand.nextF() * 150,
+                                        1 + rand.nextF() * 150);
+            const GMatrix m = GMatrix::Translate(center.x, center.y) * GMatrix::Rotate(rand.nextF() * 6.3f);
+            clipCanvas->save();
+            clipCanvas->concat(m);
+            clipCanvas->clipRect(r);
+            // a rect well past the clip, so only the clip decides what is covered
+            clipCanvas->drawRect(GRect::LTRB(r.left - 500, r.top - 500, r.right + 500, r.bottom + 500), paint);
+            clipCanvas->restore();
+            drawCanvas->save();
+            drawCanvas->concat(m);
+            drawCanvas->drawRect(r, paint);
+            drawCanvas->restore();
+        }
+
+        const GPaint after = random_paint(rand);
+        const GRect afterRect = GRect::XYWH(rand.nextF() * W, rand.nextF() * H, rand.nextF() * W, rand.nextF() * H);
+        clipCanvas->drawRect(afterRect, after);
+        drawCanvas->drawRect(afterRect, after);
+        clipCanvas->flush();
+        drawCanvas->flush();
+
+        if (int rows = count_differing_rows(clipped.bitmap(), drawn.bitmap())) {
+            printf("  iteration %d: %d rows differ from drawing the %s\n", iter, rows,
+                   iter % 2 == 0 ? "circle" : "rotated rect");
+            return false;
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Image files, written and read back
+
+static std::string temp_path(const char name[]) {
+    return std::string(P_tmpdir) + "/" + name;
+}
+
+static GPixel random_pixel(GRandom& rand) {
+    const int a = rand.nextF() < 0.3f ? 0xFF : rand.nextRange(0, 0xFF);
+    return GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a), rand.nextRange(0, a));
+}
+
+// Premultiplied pixels mixing what each of QOI's ops encodes: runs (some past the longest op, and
+// across rows), repeats of recent colors, small and luma-sized steps, and new colors, most of
+// them translucent.
+static void random_image(GRandom& rand, const GOwnedBitmap& bitmap) {
+    GPixel recent[8];
+    for (GPixel& p : recent) {
+        p = random_pixel(rand);
+    }
+    GPixel prev = recent[0];
+    int run = 0;
+    for (int y = 0; y < bitmap.height(); y++) {
+        GPixel* row = bitmap.bitmap().getAddr(0, y);
+        for (int x = 0; x < bitmap.width(); x++) {
+            if (run > 0) {
+                run -= 1;
+                row[x] = prev;
+                continue;
+            }
+            const float op = rand.nextF();
+            if (op < 0.2f) {
+                run = rand.nextRange(1, 100);
+            } else if (op < 0.4f) {
+                prev = recent[rand.nextRange(0, 7)];
+            } else if (op < 0.7f) {
+                const int a = GPixel_GetA(prev);
+                const int step = op < 0.55f ? 2 : 20;
+                auto nudge = [&](int c) {
+                    return std::max(0, std::min(a, c + rand.nextRange(-step, step)));
+                };
+                prev = GPixel_PackARGB(a, nudge(GPixel_GetR(prev)), nudge(GPixel_GetG(prev)),
+                                       nudge(GPixel_GetB(prev)));
+            } else {
+                prev = random_pixel(rand);
+                recent[rand.nextRange(0, 7)] = prev;
+            }
+            row[x] = prev;
+        }
+    }
+}
+
+// Odd sizes, so rows end mid-run and the bitmap's padded rows differ from the file's.
+static const struct { int fWidth, fHeight; } kImageSizes[] = {
+    {1, 1}, {7, 3}, {61, 17}, {130, 41}, {257, 9},
+};
+
+// Writing a .qoi file and reading it back gives the same premultiplied pixels, and the same
+// opaqueness.
+static bool test_qoi() {
+    GRandom rand(17);
+    const std::string path = temp_path("tests_roundtrip.qoi");
+    for (const auto& size : kImageSizes) {
+        GOwnedBitmap original(size.fWidth, size.fHeight);
+        random_image(rand, original);
+
+        GBitmap read;
+        if (!original.bitmap().writeToFile(path.c_str()) || !read.readFromFile(path.c_str())) {
+            printf("  %dx%d: could not write and read %s\n", size.fWidth, size.fHeight, path.c_str());
+            return false;
+        }
+        const bool sameSize = read.width() == size.fWidth && read.height() == size.fHeight;
+        const int rows = sameSize ? count_differing_rows(original.bitmap(), read) : -1;
+        GBitmap computed = original.bitmap();
+        computed.computeIsOpaque();
+        const bool opaque = computed.isOpaque();
+        free(read.pixels());
+        if (rows != 0) {
+            printf("  %dx%d: %s\n", size.fWidth, size.fHeight, sameSize ? "pixels differ" : "size differs");
+            return false;
+        }
+        if (read.isOpaque() != opaque) {
+            printf("  %dx%d: read back %s\n", size.fWidth, size.fHeight, opaque ? "translucent" : "opaque");
+            return false;
+        }
+    }
+    remove(path.c_str());
+    return true;
+}
+
+// Writing a .gbm file and mapping it back gives the same premultiplied pixels, in rows aligned
+// as the format promises.
+static bool test_gbm() {
+    GRandom rand(19);
+    const std::string path = temp_path("tests_roundtrip.gbm");
+    for (const auto& size : kImageSizes) {
+        GOwnedBitmap original(size.fWidth, size.fHeight);
+        random_image(rand, original);
+
+        GBitmap mapped;
+        if (!original.bitmap().writeNative(path.c_str()) || !mapped.mapFromFile(path.c_str())) {
+            printf("  %dx%d: could not write and map %s\n", size.fWidth, size.fHeight, path.c_str());
+            return false;
+        }
+        const bool sameSize = mapped.width() == size.fWidth && mapped.height() == size.fHeight;
+        const int rows = sameSize ? count_differing_rows(original.bitmap(), mapped) : -1;
+        const bool aligned = mapped.rowBytes() % 64 == 0 && (uintptr_t)mapped.pixels() % 64 == 0;
+        mapped.unmapFile();
+        if (rows != 0) {
+            printf("  %dx%d: %s\n", size.fWidth, size.fHeight, sameSize ? "pixels differ" : "size differs");
+            return false;
+        }
+        if (!aligned) {
+            printf("  %dx%d: rows are not 64-byte aligned\n", size.fWidth, size.fHeight);
+            return false;
+        }
+    }
+    remove(path.c_str());
+    return true;
+}
+
+// Writes a random image to path as QOI, stamped with the given modification time (in seconds)
+// so that rewrites are told apart however coarse the file system's clock is.
+static bool write_stamped_image(GRandom& rand, const GOwnedBitmap& bitmap, const std::string& path,
+                                time_t modified) {
+    random_image(rand, bitmap);
+    const struct timespec times[2] = {{modified, 0}, {modified, 0}};
+    return bitmap.bitmap().writeToFile(path.c_str()) &&
+           utimensat(AT_FDCWD, path.c_str(), times, 0) == 0;
+}
+
+// GImageCache decodes a file again once its modification time changes, without disturbing the
+// image callers already hold, and when many threads ask for one file at once it decodes it once.
+static bool test_image_cache() {
+    GRandom rand(23);
+    const std::string path = temp_path("tests_image_cache.qoi");
+    GOwnedBitmap first(37, 29), second(37, 29);
+
+    GImageCache cache;
+    GImage before, cached, after;
+    const bool ok = write_stamped_image(rand, first, path, 1000000000) &&
+                    (before = cache.find(path.c_str())) &&
+                    (cached = cache.find(path.c_str())) &&
+                    write_stamped_image(rand, second, path, 1000000001) &&
+                    (after = cache.find(path.c_str()));
+    if (!ok) {
+        printf("  could not write and find %s\n", path.c_str());
+        return false;
+    }
+    if (cached != before || count_differing_rows(first.bitmap(), *before) != 0) {
+        printf("  an unchanged file was not found in the cache\n");
+        return false;
+    }
+    if (after == before || count_differing_rows(second.bitmap(), *after) != 0 ||
+        count_differing_rows(first.bitmap(), *before) != 0) {
+        printf("  a rewritten file was not decoded again\n");
+        return false;
+    }
+
+    // a larger image, so that the threads overlap its decode
+    GOwnedBitmap large(1024, 768);
+    if (!write_stamped_image(rand, large, path, 1000000002)) {
+        printf("  could not write %s\n", path.c_str());
+        return false;
+    }
+    GImageCache shared;
+    const int kThreads = 8;
+    GImage found[kThreads];
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; i++) {
+        threads.emplace_back([&, i]() {
+            while (!go.load()) {
+            }
+            found[i] = shared.find(path.c_str());
+        });
+    }
+    go.store(true);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    remove(path.c_str());
+
+    const GImageCache::Stats stats = shared.stats();
+    for (const GImage& image : found) {
+        if (!image || image != found[0]) {
+            printf("  concurrent finds returned different images\n");
+            return false;
+        }
+    }
+    if (stats.fMisses != 1 || stats.fHits != kThreads - 1) {
+        printf("  %d concurrent finds decoded %d times\n", kThreads, (int)stats.fMisses);
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// GOwnedBitmap's pool
+
+// Every row of an owned bitmap starts on a kRowAlignment boundary; a freed block is handed to the
+// next bitmap of its size, and zeroed again for it.
+static bool test_bitmap_pool() {
+    const size_t align = GOwnedBitmap::kRowAlignment;
+    for (int w = 1; w <= 300; w++) {
+        const size_t rb = GOwnedBitmap::RowBytes(w);
+        if (rb % align != 0 || rb < w * sizeof(GPixel) || rb >= w * sizeof(GPixel) + align) {
+            printf("  RowBytes(%d) is %zu\n", w, rb);
+            return false;
+        }
+    }
+
+    GRandom rand(29);
+    for (int i = 0; i < 50; i++) {
+        const int w = rand.nextRange(1, 300), h = rand.nextRange(1, 50);
+        GOwnedBitmap bitmap(w, h);
+        const GBitmap& bm = bitmap.bitmap();
+        if (bm.rowBytes() != GOwnedBitmap::RowBytes(w) || (uintptr_t)bm.pixels() % align != 0) {
+            printf("  a %dx%d bitmap's rows are not aligned\n", w, h);
+            return false;
+        }
+    }
+
+    GPurgeBitmapPool();
+    GOwnedBitmap first(123, 45);
+    GPixel* block = first.pixels();
+    memset(block, 0xAB, first.bitmap().rowBytes() * first.height());
+    first.reset();
+    GOwnedBitmap second(123, 45);
+    if (second.pixels() != block) {
+        printf("  a freed block was not reused for a bitmap of its size\n");
+        return false;
+    }
+    for (int y = 0; y < second.height(); y++) {
+        for (int x = 0; x < second.width(); x++) {
+            if (*second.bitmap().getAddr(x, y) != 0) {
+                printf("  a reused block was not zeroed\n");
+                return false;
+            }
+        }
+    }
+
+    // moving hands the block over, so it is released once
+    GOwnedBitmap moved(std::move(second));
+    if (second.pixels() || moved.pixels() != block) {
+        printf("  moving a bitmap did not hand over its block\n");
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// GArena
+
+// Records its id in order when destroyed.
+struct Tracked {
+    Tracked(int id, std::vector<int>* destroyed) : fId(id), fDestroyed(destroyed) {}
+    ~Tracked() { fDestroyed->push_back(fId); }
+
+    int fId;
+    std::vector<int>* fDestroyed;
+};
+
+// Fills the arena past its first block with tracked objects, raw allocations of every alignment,
+// and arrays. Returns false if an allocation is misaligned.
+static bool fill_arena(GArena* arena, std::vector<int>* destroyed, int count) {
+    for (int i = 0; i < count; i++) {
+        arena->make<Tracked>(i, destroyed);
+        const size_t align = (size_t)1 << (i % 9);
+        if ((uintptr_t)arena->alloc(1 + i % 37, align) % align != 0) {
+            return false;
+        }
+        arena->makeArrayNoInit<double>(i % 5)[0] = 0;
+    }
+    return true;
+}
+
+// reset() and ~GArena() destroy what make() built, newest first, exactly once. After the first
+// reset the arena holds one block big enough for the whole round, so repeating it allocates
+// nothing more.
+static bool test_arena() {
+    const int kCount = 500;
+    std::vector<int> destroyed, expected;
+    for (int i = kCount - 1; i >= 0; i--) {
+        expected.push_back(i);
+    }
+    {
+        GArena arena(256);
+        size_t settled = 0;     // what the arena holds after its first reset
+        for (int round = 0; round < 3; round++) {
+            if (!fill_arena(&arena, &destroyed, kCount)) {
+                printf("  round %d: an allocation is misaligned\n", round);
+                return false;
+            }
+            if (round > 0 && arena.bytesReserved() != settled) {
+                printf("  round %d: the arena grew after settling\n", round);
+                return false;
+            }
+            arena.reset();
+            if (destroyed != expected) {
+                printf("  round %d: reset() destroyed %d objects out of order\n", round, (int)destroyed.size());
+                return false;
+            }
+            if (arena.bytesUsed() != 0) {
+                printf("  round %d: reset() did not rewind the arena\n", round);
+                return false;
+            }
+            settled = arena.bytesReserved();
+            destroyed.clear();
+        }
+        fill_arena(&arena, &destroyed, kCount);
+    }
+    if (destroyed != expected) {
+        printf("  ~GArena() destroyed %d objects out of order\n", (int)destroyed.size());
+        return false;
+    }
+    return true;
+}
+
+const GTestRec gTestRecs[] = {
+    { test_region,          "region" },
+    { test_picture_damage,  "picture_damage" },
+    { test_scene,           "scene" },
+    { test_clip,            "clip" },
+    { test_qoi,             "qoi" },
+    { test_gbm,             "gbm" },
+    { test_image_cache,     "image_cache" },
+    { test_bitmap_pool,     "bitmap_pool" },
+    { test_arena,           "arena" },
+
+    { nullptr, nullptr },
+};
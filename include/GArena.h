@@ -0,0 +1,116 @@
+#ifndef GArena_DEFINED
+#define GArena_DEFINED
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "GTypes.h"
+
+/**
+ *  A bump allocator for short-lived objects. Allocating is a pointer increment; nothing is freed
+ *  individually. reset() runs the destructors of every object made with make(), newest first,
+ *  and rewinds the arena for reuse.
+ *
+ *  Not thread-safe: only the thread that owns the arena may allocate from it.
+ */
+class GArena {
+public:
+    explicit GArena(size_t firstBlockSize = 16 * 1024);
+    ~GArena();
+
+    GArena(const GArena&) = delete;
+    GArena& operator=(const GArena&) = delete;
+
+    /**
+     *  Return uninitialized memory, valid until the next reset(). align must be a power of 2.
+     */
+    void* alloc(size_t size, size_t align = alignof(std::max_align_t));
+
+    /**
+     *  Construct a T in the arena. Its destructor, if it has a non-trivial one, runs in reset().
+     */
+    template <typename T, typename... Args> T* make(Args&&... args) {
+        T* obj = new (this->alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            this->addDestructor(obj, [](void* ptr) { static_cast<T*>(ptr)->~T(); });
+        }
+        return obj;
+    }
+
+    /**
+     *  Uninitialized storage for count Ts. T must be trivially destructible.
+     */
+    template <typename T> T* makeArrayNoInit(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "use make() for each element");
+        return static_cast<T*>(this->alloc(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     *  Destroy everything made since the last reset and make the memory available again.
+     *  If the arena had to grow, its blocks are replaced by one block large enough for all of
+     *  them, so a workload that repeats stops allocating after its first round.
+     */
+    void reset();
+
+    // Bytes handed out since the last reset, including alignment padding.
+    size_t bytesUsed() const { return fUsed; }
+
+    // Bytes held in blocks.
+    size_t bytesReserved() const { return fReserved; }
+
+private:
+    struct Block {
+        Block* fNext;
+        size_t fSize;   // bytes after the header
+    };
+    struct Destructor {
+        void (*fProc)(void*);
+        void*       fObj;
+        Destructor* fNext;
+    };
+
+    void addDestructor(void* obj, void (*proc)(void*));
+    void addBlock(size_t minSize);
+    void freeBlocks();
+
+    Block*      fBlocks = nullptr;      // newest first
+    char*       fCursor = nullptr;
+    char*       fEnd = nullptr;
+    Destructor* fDestructors = nullptr; // newest first
+    size_t      fNextBlockSize;
+    size_t      fUsed = 0;
+    size_t      fReserved = 0;
+};
+
+/**
+ *  Lets standard containers draw their storage from a GArena. deallocate() does nothing, so a
+ *  vector that grows leaves its old buffers in the arena until reset(); reserve() where possible.
+ */
+template <typename T> class GArenaAllocator {
+public:
+    using value_type = T;
+
+    GArenaAllocator(GArena* arena) : fArena(arena) {}
+    template <typename U> GArenaAllocator(const GArenaAllocator<U>& other) : fArena(other.arena()) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(fArena->alloc(count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) {}
+
+    GArena* arena() const { return fArena; }
+
+    template <typename U> bool operator==(const GArenaAllocator<U>& other) const {
+        return fArena == other.arena();
+    }
+    template <typename U> bool operator!=(const GArenaAllocator<U>& other) const {
+        return fArena != other.arena();
+    }
+
+private:
+    GArena* fArena;
+};
+
+#endif
@@ -55,7 +55,8 @@ public:
     }
 
     /**
-     *  Attempt to read the png image stored in the named file.
+     *  Attempt to read the png image stored in the named file (or a QOI image, if the name ends
+     *  in ".qoi").
      *
      *  On success, allocate the memory for the pixels using malloc() and set bitmap to the result,
      *  returning true. The caller must call free(bitmap->fPixels) when they are finished.
@@ -66,11 +67,65 @@ public:
      */
     bool readFromFile(const char path[]);
 
+    /**
+     *  How writeToFile() trades encoding time for file size. The defaults give the smallest files
+     *  (and the same bytes as writeToFile(path)); Fast() encodes several times faster, for
+     *  intermediate images whose size doesn't matter.
+     */
+    struct PNGOptions {
+        enum Filter {
+            kNone_Filter,       // no per-row filtering; leaves more for zlib, so rarely faster
+            kMinSum_Filter,     // the heuristic from the PNG spec
+            kEntropy_Filter,    // pick the filter whose row has the least entropy
+        };
+        Filter  fFilter = kMinSum_Filter;
+
+        // 0 stores the pixels uncompressed; 1 (fastest) ... 9 (smallest) as in zlib.
+        int     fLevel = 6;
+
+        // The LZ77 window, a power of 2 up to 32768. 0 uses fLevel's.
+        int     fWindowSize = 0;
+
+        // Look for a smaller lossless color type (gray, palette, no alpha). Costs a pass counting
+        // the image's colors.
+        bool    fAutoConvert = true;
+
+        static PNGOptions Fast() {
+            PNGOptions opts;
+            opts.fLevel = 1;
+            opts.fAutoConvert = false;
+            return opts;
+        }
+    };
+
     /*
      *  Attempt to write the bitmap as a PNG into a new file (the file will be created/overwritten).
+     *  If the name ends in ".qoi" it is written as a QOI image instead, and PNGOptions are ignored.
      *  Return true on success.
      */
     bool writeToFile(const char path[]) const;
+    bool writeToFile(const char path[], const PNGOptions&) const;
+
+    /**
+     *  Write the bitmap into a .gbm file: a 64-byte header followed by the premultiplied pixels,
+     *  each row padded to a multiple of 64 bytes. The bytes are in this machine's byte order; the
+     *  format is meant for caching assets locally, not for exchanging them.
+     */
+    bool writeNative(const char path[]) const;
+
+    /**
+     *  Map a file written by writeNative() into memory read-only, and point the bitmap at its
+     *  pixels without copying or decoding them. Processes that map the same file share its pages.
+     *
+     *  The pixels must not be written to, and must be released with unmapFile() (not free()).
+     *  On failure, return false and bitmap is reset to empty.
+     */
+    bool mapFromFile(const char path[]);
+
+    /**
+     *  Release the pixels of a bitmap set up by mapFromFile(), and reset it to empty.
+     */
+    void unmapFile();
 
     /**
      *  Allocate the memory for the bitmap. If rowBytes is 0, it will be computed from w.
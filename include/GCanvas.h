@@ -5,12 +5,14 @@
 #ifndef GCanvas_DEFINED
 #define GCanvas_DEFINED
 
+#include "GCanvasStats.h"
 #include "GMatrix.h"
 #include "GPaint.h"
 #include <string>
 
 class GBitmap;
 class GPath;
+class GRegion;
 class GPoint;
 class GRect;
 
@@ -19,7 +21,7 @@ public:
     virtual ~GCanvas() {}
 
     /**
-     *  Save off a copy of the canvas state (CTM), to be later used if the balancing call to
+     *  Save off a copy of the canvas state (CTM and clip), to be later used if the balancing call to
      *  restore() is made. Calls to save/restore can be nested:
      *  save();
      *      save();
@@ -32,7 +34,7 @@ public:
     virtual void save() = 0;
 
     /**
-     *  Copy the canvas state (CTM) that was record in the correspnding call to save() back into
+     *  Copy the canvas state (CTM and clip) that was record in the correspnding call to save() back into
      *  the canvas. It is an error to call restore() if there has been no previous call to save().
      */
     virtual void restore() = 0;
@@ -46,7 +48,26 @@ public:
     virtual void concat(const GMatrix& matrix) = 0;
 
     /**
-     *  Fill the entire canvas with the specified color, using kSrc porter-duff mode.
+     *  Intersect the clip with the rectangle, mapped by the CTM. Draws (and clear) only change
+     *  pixels inside the clip. The canvas is constructed with the whole device as its clip.
+     *
+     *  The pixels inside are those whose centers are inside the mapped rectangle, as for drawRect.
+     */
+    virtual void clipRect(const GRect&) = 0;
+
+    /**
+     *  Intersect the clip with the area the path encloses (nonzero winding), mapped by the CTM.
+     */
+    virtual void clipPath(const GPath&) = 0;
+
+    /**
+     *  Intersect the clip with the region. The region is in device pixels: the CTM does not apply.
+     */
+    virtual void clipRegion(const GRegion&) = 0;
+
+    /**
+     *  Fill the entire canvas (all of the clip) with the specified color, using kSrc porter-duff
+     *  mode.
      */
     virtual void clear(const GColor&) = 0;
 
@@ -122,6 +143,41 @@ public:
     virtual void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
                           int level, const GPaint&) = 0;
 
+    /**
+     *  Return the counters accumulated since the canvas was created or resetStats() was last
+     *  called. Canvases that do not keep statistics return all zeros.
+     *
+     *  Draws running on other threads may or may not be reflected, and a draw in progress may be
+     *  partially counted.
+     */
+    virtual GCanvasStats stats() const { return GCanvasStats(); }
+
+    /**
+     *  Zero all of the counters returned by stats(). Must not be called while a draw is running.
+     */
+    virtual void resetStats() {}
+
+    /**
+     *  Finish any work the canvas has deferred, such as a clear() it has not written out yet, and
+     *  release the per-frame scratch memory it is holding (which it also does whenever restore()
+     *  returns to the outermost save level). Call this before reading the device's pixels.
+     */
+    virtual void flush() {}
+
+    /**
+     *  Set damage to the device pixels that draws (and clears) may have changed since the canvas
+     *  was created or resetDamage() was last called, and return true; return false if the canvas
+     *  does not track damage. The region is each draw's bounds, clipped, so it may hold pixels
+     *  that did not change; once it gets complicated it is simplified to its bounds. Use
+     *  GRegion::forEachRect() for a list of rects.
+     */
+    virtual bool getDamage(GRegion* damage) const { return false; }
+
+    /**
+     *  Start accumulating damage afresh.
+     */
+    virtual void resetDamage() {}
+
     // Helpers
 
     void translate(float x, float y) {
@@ -149,9 +205,20 @@ public:
 /**
  *  If the bitmap is valid for drawing into, this returns a subclass that can perform the
  *  drawing. If bitmap is invalid, this returns NULL.
+
  */
 std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap);
 
+/**
+ *  Like GCreateCanvas(), but clear() only records the color, and each 64x64 tile is written when
+ *  a draw first touches it, or at flush(). Draws onto a freshly cleared tile also blend against a
+ *  known color. Sparse drawing on a large canvas then skips most of the clear.
+ *
+ *  The bitmap's pixels are stale until flush() (or the canvas is destroyed), so nothing else may
+ *  read or write them until then: not writeToFile(), not a bitmap shader, not another canvas.
+ */
+std::unique_ptr<GCanvas> GCreateDeferredCanvas(const GBitmap& bitmap);
+
 /**
  *  Implement this, drawing into the provided canvas, and returning the title of your artwork.
  */
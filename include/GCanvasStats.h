@@ -0,0 +1,77 @@
+#ifndef GCanvasStats_DEFINED
+#define GCanvasStats_DEFINED
+
+#include "GTypes.h"
+
+/**
+ *  Counters describing the work a canvas has done since it was created or last reset.
+ *  Returned by GCanvas::stats().
+ */
+struct GCanvasStats {
+    enum Primitive {
+        kClear,
+        kRect,
+        kConvexPolygon,
+        kPath,
+        kMesh,
+        kQuad,
+        kPrimitiveCount,
+    };
+
+    enum ShaderType {
+        kBitmapShader,
+        kLinearGradientShader,
+        kTriColorShader,
+        kProxyShader,
+        kCompositeShader,
+        kOtherShader,       // any shader the canvas does not know about
+        kShaderTypeCount,
+    };
+
+    static constexpr int kBlendModeCount = 12;
+
+    // heap allocations made with operator new during one kind of draw
+    struct Allocations {
+        uint64_t fCount;
+        uint64_t fBytes;
+        uint64_t fPeakBytes;    // most bytes live at once
+        uint64_t fLiveBytes;    // not freed yet; once the draws have returned, these leaked
+    };
+
+    uint64_t fDraws[kPrimitiveCount];       // public draw calls
+    uint64_t fEdgesBuilt;                   // edges handed to the scan converter
+    uint64_t fEdgesClipped;                 // segments discarded entirely by clipping
+    uint64_t fScanlines;                    // rows visited
+    uint64_t fSpans;                        // non-empty runs of pixels written
+    uint64_t fBlendedPixels[kBlendModeCount];   // indexed by GBlendMode, after optimization
+    uint64_t fShadeRowCalls[kShaderTypeCount];
+    uint64_t fShadedPixels[kShaderTypeCount];
+    uint64_t fFillFastPath;                 // draws filled with a plain memset/fill
+    uint64_t fDstSkips;                     // draws dropped because they reduce to kDst
+    uint64_t fQuickRejects;                 // draws (or mesh triangles) dropped for missing the clip
+    uint64_t fScratchBytesPeak;             // most edge and row scratch memory one draw used
+    Allocations fAllocations[kPrimitiveCount];  // only counted while allocation tracking is on
+
+    uint64_t totalDraws() const {
+        uint64_t total = 0;
+        for (uint64_t n : fDraws) {
+            total += n;
+        }
+        return total;
+    }
+};
+
+/**
+ *  Turn allocation tracking on or off for every canvas in the process. While it is on, each
+ *  operator new made by a draw call (on any of the threads working on it) is attributed to that
+ *  canvas and the draw's primitive, and reported in GCanvasStats::fAllocations.
+ *
+ *  Off by default: tracking takes a process-wide lock on every allocation and free. It also needs
+ *  the library built with -DG_ALLOC_TRACKING, which replaces the global operator new and delete
+ *  (so an application with its own cannot link against it); without it GSetAllocTracking() does
+ *  nothing and GGetAllocTracking() stays false.
+ */
+void GSetAllocTracking(bool enabled);
+bool GGetAllocTracking();
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef GImageCache_DEFINED
+#define GImageCache_DEFINED
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "GBitmap.h"
+
+/**
+ *  A decoded image shared through GImageCache. Its pixels must not be modified. They are freed
+ *  when the last reference goes away, whether or not the cache still holds one.
+ */
+typedef std::shared_ptr<const GBitmap> GImage;
+
+/**
+ *  Decodes image files (anything GBitmap::readFromFile() reads) once and shares the results.
+ *
+ *  Entries are keyed by path and the file's modification time, so an edited file is decoded
+ *  again. The cache keeps the most recently used images until their pixels exceed its byte
+ *  budget; evicting one only drops the cache's reference.
+ *
+ *  Thread-safe. If several threads ask for the same file at once, one decodes it and the others
+ *  wait for its result.
+ *
+ *      GImage spock = GImageCache::Default().find("apps/spock.png");
+ *      auto shader = GCreateBitmapShader(*spock, ...);   // keep spock alive while drawing
+ */
+class GImageCache {
+public:
+    struct Stats {
+        uint64_t fHits;
+        uint64_t fMisses;       // decodes started
+        uint64_t fWaits;        // lookups that waited for another thread's decode
+        uint64_t fEvictions;
+    };
+
+    explicit GImageCache(size_t byteBudget = kDefaultByteBudget);
+
+    // The process-wide cache.
+    static GImageCache& Default();
+
+    /**
+     *  Return the decoded image in the named file, or null if it can't be read.
+     */
+    GImage find(const char path[]);
+
+    size_t byteBudget() const;
+    // Evicts as needed to fit the new budget.
+    void setByteBudget(size_t);
+
+    // Bytes of pixels the cache holds references to.
+    size_t bytesUsed() const;
+
+    // Drop every cached image that is not being decoded.
+    void purge();
+
+    Stats stats() const;
+
+    static constexpr size_t kDefaultByteBudget = 256 << 20;
+
+private:
+    struct Entry {
+        int64_t fModified;      // ns since the epoch
+        GImage  fImage;         // null while it is being decoded
+        std::list<std::string>::iterator fLRU;  // valid once fImage is set
+    };
+    typedef std::unordered_map<std::string, Entry> EntryMap;
+
+    // These require fMutex. Only decoded entries may be evicted.
+    void evict(EntryMap::iterator);
+    void evictOverBudget();
+
+    mutable std::mutex      fMutex;
+    std::condition_variable fDecoded;
+    EntryMap                fEntries;
+    std::list<std::string>  fLRU;       // paths of decoded entries, most recently used first
+    size_t                  fBudget;
+    size_t                  fUsed = 0;
+    Stats                   fStats = {};
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef GOverdrawCanvas_DEFINED
+#define GOverdrawCanvas_DEFINED
+
+#include "GCanvas.h"
+
+/**
+ *  A debugging canvas that draws normally into its bitmap, and also counts how many times each
+ *  pixel has been written (by clear, fills and blends alike). Counts saturate at 65535.
+ */
+class GOverdrawCanvas : public GCanvas {
+public:
+    /**
+     *  Per-pixel write counts, width x height, packed with no padding between rows.
+     */
+    virtual const uint16_t* counts() const = 0;
+
+    /**
+     *  Total pixel writes divided by the number of pixels in the bitmap.
+     */
+    virtual double overdrawRatio() const = 0;
+
+    /**
+     *  Fill histogram[0..n-1] with the number of pixels written exactly i times. The last bucket
+     *  also collects every pixel written n-1 or more times.
+     */
+    virtual void histogram(uint64_t histogram[], int n) const = 0;
+
+    /**
+     *  Write the counts as a false-color PNG: black for 0 writes, then blue, green, pink and red
+     *  for 1, 2, 3 and 4, darkening to deep red at 8 or more.
+     */
+    virtual bool writeHeatmap(const char path[]) const = 0;
+
+    /**
+     *  Zero all of the counts. The bitmap is left alone.
+     */
+    virtual void resetCounts() = 0;
+};
+
+/**
+ *  Returns null if the bitmap is invalid for drawing into.
+ */
+std::unique_ptr<GOverdrawCanvas> GCreateOverdrawCanvas(const GBitmap& bitmap);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef GOwnedBitmap_DEFINED
+#define GOwnedBitmap_DEFINED
+
+#include "GBitmap.h"
+
+/**
+ *  A GBitmap that owns its pixels and frees them when it goes away.
+ *
+ *  Each row starts on a kRowAlignment boundary: rowBytes is width * 4 rounded up. The memory
+ *  comes from a process-wide pool bucketed by size, so offscreens and scratch bitmaps of sizes
+ *  that recur are recycled instead of being allocated (and zeroed by the kernel) each time.
+ *
+ *      GOwnedBitmap offscreen(w, h);
+ *      auto canvas = GCreateCanvas(offscreen);
+ */
+class GOwnedBitmap {
+public:
+    static constexpr size_t kRowAlignment = 64;
+
+    enum Init {
+        kZero_Init,             // every pixel transparent black
+        kUninitialized_Init,    // for callers that overwrite every pixel (e.g. with clear())
+    };
+
+    GOwnedBitmap() {}
+    GOwnedBitmap(int width, int height, Init = kZero_Init);
+    ~GOwnedBitmap() { this->reset(); }
+
+    GOwnedBitmap(GOwnedBitmap&&);
+    GOwnedBitmap& operator=(GOwnedBitmap&&);
+    GOwnedBitmap(const GOwnedBitmap&) = delete;
+    GOwnedBitmap& operator=(const GOwnedBitmap&) = delete;
+
+    const GBitmap& bitmap() const { return fBitmap; }
+    operator const GBitmap&() const { return fBitmap; }
+
+    int width() const { return fBitmap.width(); }
+    int height() const { return fBitmap.height(); }
+    GPixel* pixels() const { return fBitmap.pixels(); }
+
+    // Return the pixels to the pool and become empty.
+    void reset();
+
+    static size_t RowBytes(int width) {
+        return (width * sizeof(GPixel) + kRowAlignment - 1) & ~(kRowAlignment - 1);
+    }
+
+private:
+    GBitmap fBitmap;
+};
+
+/**
+ *  Limit the bytes the pool keeps for reuse (default 64 MB). Blocks freed beyond it go back to
+ *  the system. 0 turns pooling off.
+ */
+void GSetBitmapPoolBudget(size_t bytes);
+
+// Free every block the pool is holding.
+void GPurgeBitmapPool();
+
+#endif
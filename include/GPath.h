@@ -87,13 +87,22 @@ public:
 
     int countPoints() const { return (int)fPts.size(); }
 
+    enum BoundsType {
+        kTight_BoundsType,          // the extent of the segments themselves
+        kControlPoints_BoundsType,  // the extent of every point, control points included
+    };
+
     /**
      *  Return the tight bounds of all of the curve and line segments in the path.
      *  Curve segments may need to be chopped at X and Y extrema to compute this correctly.
      *
+     *  kControlPoints_BoundsType instead returns the bounds of the points themselves. Each curve
+     *  lies inside the hull of its control points, so this contains the tight bounds; it may be
+     *  larger, but costs one pass over the points.
+     *
      *  If there are no points, returns an empty rect (all zeros)
      */
-    GRect bounds() const;
+    GRect bounds(BoundsType = kTight_BoundsType) const;
 
     /**
      *  Transform the path in-place by the specified matrix.
@@ -0,0 +1,64 @@
+#ifndef GPicture_DEFINED
+#define GPicture_DEFINED
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "GCanvas.h"
+
+class GRegion;
+
+/**
+ *  A recorded scene: the canvas calls made into a GPictureRecorder, which can be played into any
+ *  canvas as often as needed. Playing it clipped to a region repaints just those pixels, which is
+ *  how a frame where little changed is brought up to date:
+ *
+ *      canvas->resetDamage();
+ *      drawChangedWidgets(canvas);         // at their old and new places
+ *      GRegion damage;
+ *      canvas->getDamage(&damage);
+ *      scene->playback(canvas, damage);    // everything that overlaps them, in order
+ *
+ *  As with GRenderQueue, paths, points and colors are copied but shaders are referenced: a shader
+ *  must outlive the pictures that draw with it.
+ */
+class GPicture {
+public:
+    // Make each recorded call on the canvas, in order.
+    void playback(GCanvas*) const;
+
+    /**
+     *  Play the picture with the canvas's clip intersected with the region (in device pixels), so
+     *  that pixels outside it are left as they were. Draws that miss the region entirely are
+     *  rejected by the canvas before they do any work. The canvas's state is restored afterwards.
+     */
+    void playback(GCanvas*, const GRegion& clip) const;
+
+    // The number of recorded calls.
+    int count() const { return (int)fCommands.size(); }
+
+private:
+    friend class GPictureRecorder;
+
+    std::vector<std::function<void(GCanvas*)>> fCommands;
+};
+
+class GPictureRecorder {
+public:
+    GPictureRecorder();
+    ~GPictureRecorder();
+
+    // Calls on this canvas are recorded into the picture being built. It is valid as long as
+    // the recorder is.
+    GCanvas* canvas() { return fCanvas.get(); }
+
+    // Return everything recorded since the last call, and start recording a new picture.
+    std::unique_ptr<GPicture> finish();
+
+private:
+    std::unique_ptr<GPicture> fPicture;
+    std::unique_ptr<GCanvas> fCanvas;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef GRegion_DEFINED
+#define GRegion_DEFINED
+
+#include <algorithm>
+#include <vector>
+
+#include "GRect.h"
+
+/**
+ *  A set of integer pixels, stored as horizontal bands. Each band covers the rows [top, bottom)
+ *  and holds the sorted, disjoint spans of x that are inside it; vertically adjacent rows with the
+ *  same spans share one band. A rect is one band with one span.
+ *
+ *  Regions are values: copying one copies its bands. They are the shape of a canvas's clip (see
+ *  GCanvas::clipRegion()) and a cheap way to accumulate damage:
+ *
+ *      GRegion dirty;
+ *      dirty.op(widgetBounds, GRegion::kUnion_Op);
+ *      ...
+ *      dirty.forEachRect([&](const GIRect& r) { repaint(r); });
+ */
+class GRegion {
+public:
+    enum Op {
+        kUnion_Op,          // in either
+        kIntersect_Op,      // in both
+        kDifference_Op,     // in this, and not in the other
+    };
+
+    struct Span {
+        int fLeft, fRight;  // [fLeft, fRight)
+    };
+
+    GRegion() {}
+    explicit GRegion(const GIRect& r) { this->setRect(r); }
+
+    bool isEmpty() const { return fBands.empty(); }
+    bool isRect() const { return fBands.size() == 1 && fSpans.size() == 1; }
+
+    // The smallest rect containing the region; all zeros if it is empty.
+    const GIRect& bounds() const { return fBounds; }
+
+    void setEmpty();
+    void setRect(const GIRect&);
+
+    /**
+     *  Combine this region with the other one, storing the result in this region. Returns true
+     *  if the result is not empty.
+     */
+    bool op(const GRegion&, Op);
+    bool op(const GIRect& r, Op op) { return this->op(GRegion(r), op); }
+
+    bool contains(int x, int y) const;
+    bool contains(const GIRect&) const;
+    bool intersects(const GIRect&) const;
+
+    bool operator==(const GRegion&) const;
+    bool operator!=(const GRegion& other) const { return !(*this == other); }
+
+    // The region's area as the fewest rects bands allow: one per span of each band, top to bottom.
+    int countRects() const { return (int)fSpans.size(); }
+    template <typename Proc> void forEachRect(Proc proc) const {
+        for (size_t i = 0; i < fBands.size(); i++) {
+            for (int s = fBands[i].fFirst; s < this->spanEnd(i); s++) {
+                proc(GIRect::LTRB(fSpans[s].fLeft, fBands[i].fTop, fSpans[s].fRight, fBands[i].fBottom));
+            }
+        }
+    }
+
+    /**
+     *  Call proc(left, right) for each non-empty piece of [L, R) on row y that is inside the
+     *  region, left to right.
+     */
+    template <typename Proc> void forEachSpan(int L, int R, int y, Proc proc) const {
+        int count;
+        const Span* span = this->row(y, &count);
+        for (const Span* stop = span + count; span < stop && span->fLeft < R; span++) {
+            int left = std::max(L, span->fLeft);
+            int right = std::min(R, span->fRight);
+            if (left < right) {
+                proc(left, right);
+            }
+        }
+    }
+
+    // The spans of row y, sorted, and how many there are (possibly none).
+    const Span* row(int y, int* count) const;
+
+    class Builder;
+
+private:
+    struct Band {
+        int fTop, fBottom;
+        int fFirst;         // index of its first span
+    };
+
+    int spanEnd(size_t band) const {
+        return band + 1 < fBands.size() ? fBands[band + 1].fFirst : (int)fSpans.size();
+    }
+
+    // Append a band, or extend the last one if it ends at top with the same spans.
+    void appendBand(int top, int bottom, const Span spans[], int count);
+    void computeBounds();
+
+    std::vector<Band> fBands;
+    std::vector<Span> fSpans;
+    GIRect fBounds = {0, 0, 0, 0};
+};
+
+/**
+ *  Builds a region a row at a time, top to bottom, e.g. from a scan converter. Rows may be
+ *  skipped; identical consecutive rows are merged into one band.
+ */
+class GRegion::Builder {
+public:
+    // spans must be sorted; touching or overlapping ones are merged. y must increase.
+    void addRow(int y, const Span spans[], int count);
+    GRegion detach();
+
+private:
+    std::vector<Span> fRow;
+    GRegion fRegion;
+};
+
+#endif
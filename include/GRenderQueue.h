@@ -0,0 +1,75 @@
+#ifndef GRenderQueue_DEFINED
+#define GRenderQueue_DEFINED
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "GCanvas.h"
+#include "GScheduler.h"
+
+/**
+ *  Asynchronous front end for drawing and encoding frames.
+ *
+ *  The recording thread draws into the canvas returned by beginFrame(). Each call is copied into
+ *  a command and pushed onto a lock-free single-producer/single-consumer ring. A render thread
+ *  plays the commands into a real canvas, and each finished frame is handed to the shared
+ *  worker pool to be written as a PNG. Scene building, rasterization and encoding of successive
+ *  frames therefore overlap.
+ *
+ *      GRenderQueue queue;
+ *      for (...) {
+ *          GCanvas* canvas = queue.beginFrame(w, h);
+ *          canvas->drawRect(...);
+ *          futures.push_back(queue.endFrame(path));
+ *      }
+ *
+ *  Only one thread may record. Paths, points and colors are copied, but shaders are referenced:
+ *  a shader must outlive the frames that use it and must not be drawn with elsewhere until they
+ *  are done.
+ */
+class GRenderQueue {
+public:
+    // capacity is the number of commands the ring holds before the recorder has to wait
+    explicit GRenderQueue(int capacity = 1024);
+
+    // Waits for every queued frame to be rendered and encoded.
+    ~GRenderQueue();
+
+    /**
+     *  Start recording a new frame of the given size, cleared to transparent. The returned canvas
+     *  is valid until endFrame().
+     */
+    GCanvas* beginFrame(int width, int height);
+
+    /**
+     *  Finish the current frame. The returned future becomes true once the frame has been
+     *  written to path, or false if it could not be drawn or written.
+     */
+    std::future<bool> endFrame(const char path[]);
+
+private:
+    struct Command;
+    class Recorder;
+
+    void push(Command*);
+    Command* pop();
+    void renderLoop();
+
+    const uint64_t           fMask;
+    std::vector<Command*>    fRing;
+    alignas(64) std::atomic<uint64_t> fHead{0};  // next slot the render thread reads
+    alignas(64) std::atomic<uint64_t> fTail{0};  // next slot the recorder writes
+
+    std::atomic<bool>        fSleeping{false};
+    std::mutex               fMutex;
+    std::condition_variable  fWake;
+
+    std::unique_ptr<Recorder> fRecorder;
+    GTaskGroup               fEncoders;
+    std::thread              fRenderThread;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef GScene_DEFINED
+#define GScene_DEFINED
+
+#include <memory>
+#include <vector>
+
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "GMatrix.h"
+#include "GPaint.h"
+#include "GRect.h"
+#include "GRegion.h"
+
+class GBVH;
+class GPath;
+class GPoint;
+
+/**
+ *  A retained scene drawn into one bitmap: a list of nodes, each a rect, path or mesh with its
+ *  own matrix and paint, painted in the order they were added over a background color.
+ *
+ *  Each node keeps its device bounds, and rect and path nodes without a shader keep their
+ *  geometry already mapped to device space. render() repaints only the 64x64 tiles that overlap
+ *  the old or new bounds of nodes changed since the last render, drawing just the nodes (found
+ *  through a bounding-volume hierarchy) that overlap those tiles:
+ *
+ *      GScene scene(bitmap, background);
+ *      GScene::ID value = scene.addPath(digits, paint, matrix);
+ *      ...
+ *      scene.render();                     // paints everything the first time
+ *      scene.setPath(value, newDigits);
+ *      scene.render();                     // repaints only the tiles under the old and new digits
+ *
+ *  The repainted tiles come out byte-for-byte as if the whole bitmap had been repainted, shaded
+ *  nodes included: a clip never changes the pixels a draw writes, only which of them it writes.
+ *
+ *  Paths, points and colors are copied, but shaders are referenced and must outlive the nodes
+ *  that draw with them. The scene cannot see a shader change: invalidate() the nodes using it.
+ */
+class GScene {
+public:
+    typedef int ID;
+
+    // The bitmap's pixels must stay valid as long as the scene does.
+    GScene(const GBitmap& device, const GColor& background);
+    ~GScene();
+
+    /**
+     *  Add a node on top of the others, and return its ID. IDs are never reused, even after the
+     *  node is removed.
+     */
+    ID addRect(const GRect&, const GPaint&, const GMatrix& = GMatrix());
+    ID addPath(const GPath&, const GPaint&, const GMatrix& = GMatrix());
+    ID addMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count,
+               const int indices[], const GPaint&, const GMatrix& = GMatrix());
+
+    // Change a node. A rect node only takes setRect(), a path node only setPath().
+    void setMatrix(ID, const GMatrix&);
+    void setPaint(ID, const GPaint&);
+    void setRect(ID, const GRect&);
+    void setPath(ID, const GPath&);
+    void remove(ID);
+
+    // Repaint the node at the next render() even though it has not changed.
+    void invalidate(ID);
+
+    // The device pixels the node may cover, clipped to the bitmap; empty if it was removed.
+    GIRect bounds(ID) const;
+
+    /**
+     *  Bring the bitmap up to date with the scene, and return the region repainted: all of it the
+     *  first time, then the tiles touched by changed nodes.
+     */
+    GRegion render();
+
+    // The canvas render() draws with, e.g. for its stats().
+    const GCanvas* canvas() const { return fCanvas.get(); }
+
+private:
+    struct Node;
+
+    ID add(Node*);
+    // A node that was just changed: recompute what it caches and repaint it at the next render.
+    void changed(ID);
+    // Map the node's geometry to device space where it can be, and return its device bounds.
+    GIRect prepare(Node*) const;
+    void draw(const Node&);
+
+    const GBitmap fDevice;
+    const GColor fBackground;
+    std::unique_ptr<GCanvas> fCanvas;
+
+    std::vector<std::unique_ptr<Node>> fNodes;  // by ID; null once removed
+    std::vector<GIRect> fBounds;                // each node's bounds, empty once removed
+    std::vector<ID> fChanged;
+    GRegion fRemoved;                           // bounds of nodes removed since the last render
+
+    std::unique_ptr<GBVH> fTree;
+    bool fTreeStale = true;     // nodes were added: rebuild the tree
+    int fMoves = 0;             // bounds changed since it was built: refit it, or rebuild if many
+    bool fPainted = false;      // render() has drawn everything once
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef GScheduler_DEFINED
+#define GScheduler_DEFINED
+
+#include <atomic>
+#include <functional>
+
+#include "GTypes.h"
+
+/**
+ *  Returns the number of background worker threads in the process-wide pool. The thread that
+ *  calls GParallelFor() or GTaskGroup::wait() always helps, so 0 means everything runs on the
+ *  caller.
+ */
+int GGetWorkerCount();
+
+/**
+ *  Returns the index [0, GGetWorkerCount()) of the pool worker running the calling thread, or -1
+ *  if it is not one of the pool's workers.
+ */
+int GGetWorkerIndex();
+
+/**
+ *  Resize the process-wide pool. Every canvas and bitmap in the process shares this one pool.
+ *  A negative count restores the default (one less than the number of hardware threads).
+ *  Must not be called while any parallel work is in flight.
+ */
+void GSetWorkerCount(int count);
+
+/**
+ *  An opaque pointer per thread that follows work onto the pool: GTaskGroup::run() and
+ *  GParallelFor() capture the caller's context, and whichever thread runs the work sees it while
+ *  it runs. Whatever it points to must outlive that work. Defaults to null.
+ */
+void* GGetTaskContext();
+void GSetTaskContext(void* context);
+
+/**
+ *  A set of tasks that can be waited on together. Tasks queued from a worker go onto that
+ *  worker's own deque, where idle workers can steal them.
+ */
+class GTaskGroup {
+public:
+    GTaskGroup() {}
+    ~GTaskGroup() { this->wait(); }
+
+    /**
+     *  Queue work to run on the pool. With no workers it runs immediately on the caller.
+     */
+    void run(std::function<void()> work);
+
+    /**
+     *  Block until every task passed to run() has finished, running queued tasks on the
+     *  calling thread meanwhile.
+     */
+    void wait();
+
+private:
+    std::atomic<int> fPending{0};
+};
+
+/**
+ *  Split [begin, end) into chunks of at most grain items and call fn(start, stop) for each chunk,
+ *  running the chunks concurrently on the shared work-stealing pool. Returns once every chunk
+ *  has finished. The chunks must not write to the same memory.
+ */
+void GParallelFor(int begin, int end, int grain, const std::function<void(int start, int stop)>& fn);
+
+/**
+ *  GParallelFor over the rows [top, bottom) of an image that is width pixels wide. Each task gets
+ *  enough rows to be worth handing to another thread; small images run on the caller.
+ */
+void GParallelForRows(int top, int bottom, int width, const std::function<void(int y0, int y1)>& fn);
+
+#endif
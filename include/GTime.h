@@ -8,10 +8,16 @@
 #include "GTypes.h"
 
 using GMSec = unsigned long;
+using GNSec = uint64_t;
 
 class GTime {
 public:
     static GMSec GetMSec();
+
+    /**
+     *  Nanoseconds from a monotonic clock. Only differences between two calls are meaningful.
+     */
+    static GNSec GetNSec();
 };
 
 #endif
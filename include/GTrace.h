@@ -0,0 +1,81 @@
+#ifndef GTrace_DEFINED
+#define GTrace_DEFINED
+
+#include "GTime.h"
+
+/**
+ *  Timeline tracing in the Chrome trace-event format (chrome://tracing, ui.perfetto.dev).
+ *
+ *  Tracing is compiled in only when G_TRACE is defined (e.g. make image CPPFLAGS=-DG_TRACE).
+ *  Otherwise the GTRACE_ macros expand to nothing, and the functions below do nothing.
+ *
+ *  Each thread appends its events to its own buffer without locking. GTraceWriteFile() gathers
+ *  them, so it must not be called while traced work is running on other threads.
+ */
+
+enum class GTraceLevel {
+    kOff,
+    kDraws,     // canvas entry points and their phases (edges, sort, scanlines, encode, ...)
+    kSpans,     // also every shadeRow() and blend loop; much larger traces
+};
+
+/**
+ *  Whether tracing is compiled in. If not, nothing is ever recorded or written.
+ */
+bool GTraceIsCompiledIn();
+
+/**
+ *  Start recording events at or below the given level. Tracing starts out off.
+ */
+void GTraceSetLevel(GTraceLevel);
+
+/**
+ *  Write every event recorded so far as a Chrome trace JSON file, then discard them.
+ *  Returns false if the file could not be written, or if tracing is compiled out.
+ */
+bool GTraceWriteFile(const char path[]);
+
+#ifdef G_TRACE
+
+#include <atomic>
+
+class GTraceScope {
+public:
+    GTraceScope(const char name[], GTraceLevel level) : fName(nullptr) {
+        if ((int)level <= gTraceLevel.load(std::memory_order_relaxed)) {
+            fName = name;
+            fStart = GTime::GetNSec();
+        }
+    }
+    ~GTraceScope() {
+        if (fName) {
+            Record(fName, fStart, GTime::GetNSec());
+        }
+    }
+
+    static std::atomic<int> gTraceLevel;
+
+private:
+    static void Record(const char name[], GNSec start, GNSec end);
+
+    const char* fName;
+    GNSec       fStart;
+};
+
+#define GTRACE_CONCAT_(a, b)    a##b
+#define GTRACE_CONCAT(a, b)     GTRACE_CONCAT_(a, b)
+
+// name must be a string literal (or otherwise outlive the trace)
+#define GTRACE_SCOPE(name) \
+    GTraceScope GTRACE_CONCAT(gtrace_, __LINE__)(name, GTraceLevel::kDraws)
+#define GTRACE_SPAN_SCOPE(name) \
+    GTraceScope GTRACE_CONCAT(gtrace_, __LINE__)(name, GTraceLevel::kSpans)
+
+#else
+
+#define GTRACE_SCOPE(name)
+#define GTRACE_SPAN_SCOPE(name)
+
+#endif
+
+#endif
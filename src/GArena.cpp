@@ -0,0 +1,74 @@
+#include "../include/GArena.h"
+
+GArena::GArena(size_t firstBlockSize) : fNextBlockSize(firstBlockSize) {}
+
+GArena::~GArena() {
+    this->reset();
+    this->freeBlocks();
+}
+
+void* GArena::alloc(size_t size, size_t align) {
+    assert(align && !(align & (align - 1)));
+    uintptr_t start = ((uintptr_t)fCursor + align - 1) & ~(uintptr_t)(align - 1);
+    if (!fCursor || start + size > (uintptr_t)fEnd) {
+        this->addBlock(size + align);
+        start = ((uintptr_t)fCursor + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    fUsed += start + size - (uintptr_t)fCursor;
+    fCursor = (char*)(start + size);
+    return (void*)start;
+}
+
+void GArena::addDestructor(void* obj, void (*proc)(void*)) {
+    Destructor* d = static_cast<Destructor*>(this->alloc(sizeof(Destructor), alignof(Destructor)));
+    d->fProc = proc;
+    d->fObj = obj;
+    d->fNext = fDestructors;
+    fDestructors = d;
+}
+
+void GArena::addBlock(size_t minSize) {
+    size_t size = std::max(fNextBlockSize, minSize);
+    Block* block = (Block*)malloc(sizeof(Block) + size);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    block->fNext = fBlocks;
+    block->fSize = size;
+    fBlocks = block;
+    fCursor = (char*)(block + 1);
+    fEnd = fCursor + size;
+    fReserved += size;
+    // grow geometrically so that a big frame needs few blocks
+    fNextBlockSize = size * 2;
+}
+
+void GArena::freeBlocks() {
+    while (fBlocks) {
+        Block* next = fBlocks->fNext;
+        free(fBlocks);
+        fBlocks = next;
+    }
+    fCursor = fEnd = nullptr;
+    fReserved = 0;
+}
+
+void GArena::reset() {
+    for (Destructor* d = fDestructors; d; d = d->fNext) {
+        d->fProc(d->fObj);
+    }
+    fDestructors = nullptr;
+
+    if (fBlocks && fBlocks->fNext) {
+        // coalesce, so that the same amount of work fits in one block next time
+        size_t total = fReserved;
+        this->freeBlocks();
+        fNextBlockSize = total;
+        this->addBlock(total);
+        fNextBlockSize = total;
+    } else if (fBlocks) {
+        fCursor = (char*)(fBlocks + 1);
+        fEnd = fCursor + fBlocks->fSize;
+    }
+    fUsed = 0;
+}
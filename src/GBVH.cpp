@@ -0,0 +1,97 @@
+#include "GBVH.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+
+// items per leaf: small enough that a query tests few rects it did not need to
+static const int kLeafSize = 4;
+
+// the smallest rect containing both, where an empty rect contains nothing
+static GIRect join(const GIRect& a, const GIRect& b) {
+    if (a.isEmpty()) {
+        return b;
+    }
+    if (b.isEmpty()) {
+        return a;
+    }
+    return GIRect::LTRB(std::min(a.left, b.left), std::min(a.top, b.top),
+                        std::max(a.right, b.right), std::max(a.bottom, b.bottom));
+}
+
+void GBVH::build(const std::vector<GIRect>& bounds) {
+    const int n = (int)bounds.size();
+    fItems.resize(n);
+    for (int i = 0; i < n; i++) {
+        fItems[i] = i;
+    }
+    fNodes.clear();
+    fNodes.reserve(n > 0 ? 2 * ((n + kLeafSize - 1) / kLeafSize) : 0);
+    if (n > 0) {
+        fNodes.push_back(Node());
+        this->buildNode(0, 0, n, bounds);
+    }
+    fItemBounds.resize(n);
+    for (int i = 0; i < n; i++) {
+        fItemBounds[i] = bounds[fItems[i]];
+    }
+}
+
+void GBVH::buildNode(int index, int first, int count, const std::vector<GIRect>& bounds) {
+    GIRect box = GIRect::LTRB(0, 0, 0, 0);
+    // the bounds of the centers, each side halved first so that the sums cannot overflow
+    int cl = INT32_MAX, ct = INT32_MAX, cr = INT32_MIN, cb = INT32_MIN;
+    for (int i = first; i < first + count; i++) {
+        const GIRect& r = bounds[fItems[i]];
+        box = join(box, r);
+        int cx = r.left / 2 + r.right / 2, cy = r.top / 2 + r.bottom / 2;
+        cl = std::min(cl, cx);
+        ct = std::min(ct, cy);
+        cr = std::max(cr, cx);
+        cb = std::max(cb, cy);
+    }
+    fNodes[index].fBounds = box;
+
+    if (count <= kLeafSize) {
+        fNodes[index].fFirst = first;
+        fNodes[index].fCount = count;
+        return;
+    }
+
+    const bool splitX = cr - cl >= cb - ct;
+    int* begin = fItems.data() + first;
+    int* mid = begin + count / 2;
+    std::nth_element(begin, mid, begin + count, [&](int a, int b) {
+        const GIRect& ra = bounds[a];
+        const GIRect& rb = bounds[b];
+        return splitX ? ra.left / 2 + ra.right / 2 < rb.left / 2 + rb.right / 2
+                      : ra.top / 2 + ra.bottom / 2 < rb.top / 2 + rb.bottom / 2;
+    });
+
+    const int child = (int)fNodes.size();
+    fNodes.push_back(Node());
+    fNodes.push_back(Node());
+    fNodes[index].fFirst = child;
+    fNodes[index].fCount = 0;
+    this->buildNode(child, first, count / 2, bounds);
+    this->buildNode(child + 1, first + count / 2, count - count / 2, bounds);
+}
+
+void GBVH::refit(const std::vector<GIRect>& bounds) {
+    assert(bounds.size() == fItems.size());
+    for (size_t i = 0; i < fItems.size(); i++) {
+        fItemBounds[i] = bounds[fItems[i]];
+    }
+    for (int n = (int)fNodes.size() - 1; n >= 0; n--) {
+        Node& node = fNodes[n];
+        if (node.fCount > 0) {
+            GIRect box = GIRect::LTRB(0, 0, 0, 0);
+            for (int i = node.fFirst; i < node.fFirst + node.fCount; i++) {
+                box = join(box, fItemBounds[i]);
+            }
+            node.fBounds = box;
+        } else {
+            node.fBounds = join(fNodes[node.fFirst].fBounds, fNodes[node.fFirst + 1].fBounds);
+        }
+    }
+}
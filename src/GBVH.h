@@ -0,0 +1,72 @@
+#ifndef GBVH_DEFINED
+#define GBVH_DEFINED
+
+#include <vector>
+
+#include "../include/GRect.h"
+
+/**
+ *  Bounding-volume hierarchy over a list of integer rects, for finding the ones that overlap a
+ *  query rect without looking at every one. Items are identified by their index in the list.
+ *
+ *  build() sorts the items into a binary tree by splitting each node at the median of its items'
+ *  centers along its longer side. When items only move, refit() recomputes the boxes in place,
+ *  keeping the tree's shape; that is linear, but queries slow down as the shape goes stale, so
+ *  rebuild once items have moved far.
+ */
+class GBVH {
+public:
+    // Index all of the rects. Empty ones are kept, but never overlap anything.
+    void build(const std::vector<GIRect>& bounds);
+
+    // Recompute the boxes from bounds, which must have as many items as when built.
+    void refit(const std::vector<GIRect>& bounds);
+
+    int count() const { return (int)fItems.size(); }
+
+    // Call proc(index) for each item whose rect overlaps r, in no particular order.
+    template <typename Proc> void query(const GIRect& r, Proc proc) const {
+        if (fNodes.empty() || r.isEmpty()) {
+            return;
+        }
+        int stack[64];
+        int depth = 0;
+        stack[depth++] = 0;
+        while (depth > 0) {
+            const Node& node = fNodes[stack[--depth]];
+            if (!overlaps(node.fBounds, r)) {
+                continue;
+            }
+            if (node.fCount > 0) {
+                for (int i = node.fFirst; i < node.fFirst + node.fCount; i++) {
+                    if (overlaps(fItemBounds[i], r)) {
+                        proc(fItems[i]);
+                    }
+                }
+            } else {
+                stack[depth++] = node.fFirst;
+                stack[depth++] = node.fFirst + 1;
+            }
+        }
+    }
+
+private:
+    struct Node {
+        GIRect fBounds;
+        int fFirst;     // a leaf's first item, or an inner node's first child (the second follows it)
+        int fCount;     // items in a leaf, 0 for an inner node
+    };
+
+    static bool overlaps(const GIRect& a, const GIRect& b) {
+        return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+    }
+
+    void buildNode(int index, int first, int count, const std::vector<GIRect>& bounds);
+
+    // children always come after their parent, so walking backwards visits them first
+    std::vector<Node> fNodes;
+    std::vector<int> fItems;            // item indices, grouped by leaf
+    std::vector<GIRect> fItemBounds;    // their rects, in the same order
+};
+
+#endif
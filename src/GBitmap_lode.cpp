@@ -3,88 +3,276 @@
  */
 
 #include "../include/GBitmap.h"
+#include "../include/GScheduler.h"
+#include "../include/GTrace.h"
+#include "GBitmap_qoi.h"
 #include "lodepng.h"
+#include <cmath>
+#include <strings.h>
 
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+// 255/a for each alpha, nudged up one ulp so that (int)(c * recip + 0.5f) rounds exactly as
+// (c * 255 + a/2) / a does, for every c in 0..255 (checked exhaustively). 0 and 255 leave c as is.
+static const float* unpremul_table() {
+    static const struct Table {
+        float fRecip[256];
+        Table() {
+            fRecip[0] = fRecip[255] = 1;
+            for (int a = 1; a < 255; ++a) {
+                fRecip[a] = std::nextafter(255.0f / a, 256.0f);
+            }
+        }
+    } table;
+    return table.fRecip;
+}
+
+static inline uint8_t unpremul(int c, float recip) {
+    return (uint8_t)(int)(c * recip + 0.5f);
+}
+
+// PNG requires unpremultiplied, but GPixel is premultiplied
 static void convertToPNG(const GPixel src[], int width, uint8_t dst[]) {
-    for (int i = 0; i < width; i++) {
-        GPixel c = *src++;
+    const float* recip = unpremul_table();
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    const __m128 half = _mm_set1_ps(0.5f);
+    auto channel = [&](__m128i c, __m128 rcp) {
+        __m128 unscaled = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(c), rcp), half);
+        return _mm_and_si128(_mm_cvttps_epi32(unscaled), mask);
+    };
+    for (; i + 4 <= width; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i a = _mm_srli_epi32(px, GPIXEL_SHIFT_A);
+        __m128 rcp = _mm_setr_ps(recip[GPixel_GetA(src[i + 0])], recip[GPixel_GetA(src[i + 1])],
+                                 recip[GPixel_GetA(src[i + 2])], recip[GPixel_GetA(src[i + 3])]);
+        __m128i r = channel(_mm_and_si128(_mm_srli_epi32(px, GPIXEL_SHIFT_R), mask), rcp);
+        __m128i g = channel(_mm_and_si128(_mm_srli_epi32(px, GPIXEL_SHIFT_G), mask), rcp);
+        __m128i b = channel(_mm_and_si128(_mm_srli_epi32(px, GPIXEL_SHIFT_B), mask), rcp);
+        // bytes R G B A in memory
+        __m128i rgba = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                                    _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), rgba);
+    }
+#endif
+    for (; i < width; i++) {
+        GPixel c = src[i];
         int a = GPixel_GetA(c);
-        int r = GPixel_GetR(c);
-        int g = GPixel_GetG(c);
-        int b = GPixel_GetB(c);
-        
-        // PNG requires unpremultiplied, but GPixel is premultiplied
-        if (0 != a && 255 != a) {
-            r = (r * 255 + a/2) / a;
-            g = (g * 255 + a/2) / a;
-            b = (b * 255 + a/2) / a;
-        }
-        *dst++ = r;
-        *dst++ = g;
-        *dst++ = b;
-        *dst++ = a;
+        float rcp = recip[a];
+        dst[i * 4 + 0] = unpremul(GPixel_GetR(c), rcp);
+        dst[i * 4 + 1] = unpremul(GPixel_GetG(c), rcp);
+        dst[i * 4 + 2] = unpremul(GPixel_GetB(c), rcp);
+        dst[i * 4 + 3] = a;
+    }
+}
+
+// The pixels decide, not isOpaque(): a bitmap loaded as opaque may since have been drawn into
+// with alpha.
+static bool rowIsOpaque(const GPixel src[], int width) {
+    unsigned opaque = 0xFF;
+    for (int i = 0; i < width; i++) {
+        opaque &= GPixel_GetA(src[i]);
+    }
+    return opaque == 0xFF;
+}
+
+// Every alpha is 255, so there is nothing to divide: just reorder the bytes.
+static void convertOpaqueToPNG(const GPixel src[], int width, uint8_t dst[]) {
+    for (int i = 0; i < width; i++) {
+        GPixel c = src[i];
+        dst[i * 4 + 0] = GPixel_GetR(c);
+        dst[i * 4 + 1] = GPixel_GetG(c);
+        dst[i * 4 + 2] = GPixel_GetB(c);
+        dst[i * 4 + 3] = 0xFF;
     }
 }
 
+// zlib-like levels, mapped onto lodepng's LZ77 knobs. 6 is lodepng's default.
+static const struct {
+    unsigned fWindowSize;
+    unsigned fNiceMatch;
+    unsigned fLazyMatching;
+} gLevels[10] = {
+    {    0,   0, 0 },    // stored, no LZ77
+    {  256,  16, 0 },
+    {  512,  32, 0 },
+    { 1024,  64, 0 },
+    { 1024, 128, 1 },
+    { 2048, 128, 0 },
+    { 2048, 128, 1 },
+    { 8192, 258, 1 },
+    {16384, 258, 1 },
+    {32768, 258, 1 },
+};
+
+static LodePNGFilterStrategy filter_strategy(GBitmap::PNGOptions::Filter filter) {
+    switch (filter) {
+        case GBitmap::PNGOptions::kNone_Filter: return LFS_ZERO;
+        case GBitmap::PNGOptions::kMinSum_Filter: return LFS_MINSUM;
+        case GBitmap::PNGOptions::kEntropy_Filter: return LFS_ENTROPY;
+    }
+    return LFS_MINSUM;
+}
+
+static bool is_qoi(const char path[]) {
+    const size_t len = strlen(path);
+    return len >= 4 && !strcasecmp(path + len - 4, ".qoi");
+}
+
 bool GBitmap::writeToFile(const char path[]) const {
+    return this->writeToFile(path, PNGOptions());
+}
+
+bool GBitmap::writeToFile(const char path[], const PNGOptions& opts) const {
+    if (is_qoi(path)) {
+        return GWriteQOI(*this, path);
+    }
+    GTRACE_SCOPE("writeToFile");
+    assert(opts.fLevel >= 0 && opts.fLevel <= 9);
+    assert(opts.fWindowSize >= 0 && opts.fWindowSize <= 32768);
+    assert(!(opts.fWindowSize & (opts.fWindowSize - 1)));
+
     size_t rb = this->width() * 4;
     uint8_t* pix = (uint8_t*)malloc(this->height() * rb);
     if (!pix) {
         return false;
     }
 
-    const GPixel* src = this->pixels();
-    uint8_t* dst = pix;
-    for (int y = 0; y < this->height(); ++y) {
-        convertToPNG(src, this->width(), dst);
-        src += this->rowBytes() / 4;
-        dst += rb;
+    GParallelForRows(0, this->height(), this->width(), [&](int y0, int y1) {
+        GTRACE_SCOPE("unpremultiply");
+        for (int y = y0; y < y1; ++y) {
+            const GPixel* row = this->getAddr(0, y);
+            auto convert = rowIsOpaque(row, this->width()) ? convertOpaqueToPNG : convertToPNG;
+            convert(row, this->width(), pix + y * rb);
+        }
+    });
+
+    LodePNGState state;
+    lodepng_state_init(&state);
+    LodePNGEncoderSettings& settings = state.encoder;
+    settings.filter_strategy = filter_strategy(opts.fFilter);
+    if (opts.fFilter != PNGOptions::kMinSum_Filter) {
+        // otherwise lodepng switches palette images back to no filtering
+        settings.filter_palette_zero = 0;
+    }
+    settings.auto_convert = opts.fAutoConvert;
+
+    const int level = std::max(0, std::min(opts.fLevel, 9));
+    LodePNGCompressSettings& zlib = settings.zlibsettings;
+    if (level == 0) {
+        zlib.btype = 0;
+        zlib.use_lz77 = 0;
+    } else {
+        zlib.windowsize = opts.fWindowSize ? opts.fWindowSize : gLevels[level].fWindowSize;
+        zlib.nicematch = gLevels[level].fNiceMatch;
+        zlib.lazymatching = gLevels[level].fLazyMatching;
     }
 
-    unsigned err = lodepng_encode32_file(path, pix, this->width(), this->height());
+    unsigned char* png = nullptr;
+    size_t pngSize = 0;
+    unsigned err;
+    {
+        GTRACE_SCOPE("encode");
+        err = lodepng_encode(&png, &pngSize, pix, this->width(), this->height(), &state);
+    }
     free(pix);
+    if (!err) {
+        GTRACE_SCOPE("save");
+        err = lodepng_save_file(png, pngSize, path);
+    }
+    free(png);
+    lodepng_state_cleanup(&state);
     return err == 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-static int alpha_mul(unsigned a, unsigned c) {
-    return (a * c + 127) / 255;
+// (a * c + 127) / 255, without the divide. Exact for every a and c in 0..255.
+static inline unsigned alpha_mul(unsigned a, unsigned c) {
+    unsigned t = a * c + 128;
+    return (t + (t >> 8)) >> 8;
 }
 
-static void swizzle_rgba_row(GPixel dst[], const uint8_t src[], int count) {
-    for (int i = 0; i < count; ++i) {
-        unsigned a = src[3];
-        dst[i] = GPixel_PackARGB(a,
-                                 alpha_mul(a, src[0]),
-                                 alpha_mul(a, src[1]),
-                                 alpha_mul(a, src[2]));
-        src += 4;
+// Converts count RGBA pixels to premultiplied GPixels in place, and returns false if any of
+// them is not opaque.
+static bool premultiply_row(void* row, int count) {
+    const uint8_t* src = (const uint8_t*)row;
+    GPixel* dst = (GPixel*)row;
+    unsigned alphas = 0xFF;
+    int i = 0;
+#ifdef __SSE2__
+    // 16-bit lanes R G B A R G B A; alpha is multiplied by 255 so it comes out unchanged
+    const __m128i keepRGB = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m128i alpha255 = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    const __m128i bias = _mm_set1_epi16(128);
+    auto premul2 = [&](__m128i rgba) {
+        __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(rgba, _MM_SHUFFLE(3, 3, 3, 3)),
+                                        _MM_SHUFFLE(3, 3, 3, 3));
+        a = _mm_or_si128(_mm_and_si128(a, keepRGB), alpha255);
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(rgba, a), bias);
+        t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        // R G B A -> B G R A, which is GPixel's byte order
+        return _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, _MM_SHUFFLE(3, 0, 1, 2)),
+                                   _MM_SHUFFLE(3, 0, 1, 2));
+    };
+    const __m128i zero = _mm_setzero_si128();
+    __m128i alphaBits = _mm_set1_epi32(-1);
+    for (; i + 4 <= count; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        alphaBits = _mm_and_si128(alphaBits, px);
+        __m128i lo = premul2(_mm_unpacklo_epi8(px, zero));
+        __m128i hi = premul2(_mm_unpackhi_epi8(px, zero));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
     }
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, alphaBits);
+    alphas &= (lanes[0] & lanes[1] & lanes[2] & lanes[3]) >> 24;
+#endif
+    for (; i < count; ++i) {
+        const uint8_t* p = src + i * 4;
+        unsigned a = p[3];
+        alphas &= a;
+        dst[i] = GPixel_PackARGB(a, alpha_mul(a, p[0]), alpha_mul(a, p[1]), alpha_mul(a, p[2]));
+    }
+    return alphas == 0xFF;
 }
 
 bool GBitmap::readFromFile(const char path[]) {
+    if (is_qoi(path)) {
+        return GReadQOI(path, this);
+    }
+    GTRACE_SCOPE("readFromFile");
     unsigned w, h;
     unsigned char* pix = nullptr;
-    if (lodepng_decode32_file(&pix, &w, &h, path)) {
+    unsigned err;
+    {
+        GTRACE_SCOPE("decode");
+        err = lodepng_decode32_file(&pix, &w, &h, path);
+    }
+    if (err) {
         free(pix);
+        this->reset();
         return false;
     }
 
-    this->alloc(w, h);
-
-    GPixel* dst = this->pixels();
-    const uint8_t* src = pix;
-    size_t rb = w * 4;
-    for (unsigned y = 0; y < h; ++y) {
-        swizzle_rgba_row(dst, src, w);
-        src += rb;
-        dst += this->rowBytes() / 4;
-    }
-    free(pix);
+    // The decoded RGBA buffer is malloc'd and exactly as big as the bitmap, so it becomes the
+    // bitmap's pixels once it has been converted in place; there is never a second copy.
+    const size_t rb = w * 4;
+    std::atomic<bool> opaque{true};
+    GParallelForRows(0, h, w, [&](int y0, int y1) {
+        GTRACE_SCOPE("premultiply");
+        bool bandOpaque = true;
+        for (int y = y0; y < y1; ++y) {
+            bandOpaque &= premultiply_row(pix + y * rb, w);
+        }
+        if (!bandOpaque) {
+            opaque.store(false, std::memory_order_relaxed);
+        }
+    });
 
-    this->setIsOpaque(kCompute_IsOpaque);
+    this->reset(w, h, rb, (GPixel*)pix, opaque.load() ? kYes_IsOpaque : kNo_IsOpaque);
     return true;
 }
-
-
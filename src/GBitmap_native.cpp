@@ -0,0 +1,113 @@
+#include "../include/GBitmap.h"
+#include "../include/GTrace.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t kMagic = 0x314D4247;    // "GBM1" in little-endian files
+constexpr uint32_t kVersion = 1;
+constexpr size_t   kAlign = 64;            // the header's size, and each row's alignment
+
+enum {
+    kOpaque_Flag = 1 << 0,
+};
+
+struct Header {
+    uint32_t fMagic;
+    uint32_t fVersion;
+    uint32_t fWidth;
+    uint32_t fHeight;
+    uint64_t fRowBytes;
+    uint32_t fFlags;
+    uint8_t  fReserved[kAlign - 28];
+};
+static_assert(sizeof(Header) == kAlign, "pixels start right after the header");
+
+size_t native_row_bytes(int width) {
+    return (width * sizeof(GPixel) + kAlign - 1) & ~(kAlign - 1);
+}
+
+}  // namespace
+
+bool GBitmap::writeNative(const char path[]) const {
+    GTRACE_SCOPE("writeNative");
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+
+    Header header = {};
+    header.fMagic = kMagic;
+    header.fVersion = kVersion;
+    header.fWidth = this->width();
+    header.fHeight = this->height();
+    header.fRowBytes = native_row_bytes(this->width());
+    header.fFlags = this->isOpaque() ? kOpaque_Flag : 0;
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+    static const uint8_t zeros[kAlign] = {};
+    const size_t pixelBytes = this->width() * sizeof(GPixel);
+    const size_t padBytes = header.fRowBytes - pixelBytes;
+    for (int y = 0; ok && y < this->height(); ++y) {
+        ok = fwrite(this->getAddr(0, y), 1, pixelBytes, f) == pixelBytes &&
+             fwrite(zeros, 1, padBytes, f) == padBytes;
+    }
+    return (fclose(f) == 0) && ok;
+}
+
+bool GBitmap::mapFromFile(const char path[]) {
+    GTRACE_SCOPE("mapFromFile");
+    this->reset();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file alive
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    const Header* header = (const Header*)addr;
+    const uint64_t rb = header->fRowBytes;
+    const bool valid = header->fMagic == kMagic &&
+                       header->fVersion == kVersion &&
+                       header->fWidth <= (1 << 30) / sizeof(GPixel) &&
+                       header->fHeight <= (1 << 30) &&
+                       rb == native_row_bytes(header->fWidth) &&
+                       sizeof(Header) + header->fHeight * rb == (uint64_t)st.st_size;
+    if (!valid) {
+        munmap(addr, st.st_size);
+        return false;
+    }
+
+    GPixel* pixels = (GPixel*)((char*)addr + sizeof(Header));
+    // not validated against the pixels: that would fault in every page
+    fWidth = header->fWidth;
+    fHeight = header->fHeight;
+    fRowBytes = rb;
+    fPixels = pixels;
+    fIsOpaque = (header->fFlags & kOpaque_Flag) != 0;
+    return true;
+}
+
+void GBitmap::unmapFile() {
+    if (fPixels) {
+        char* addr = (char*)fPixels - sizeof(Header);
+        munmap(addr, sizeof(Header) + fHeight * fRowBytes);
+    }
+    this->reset();
+}
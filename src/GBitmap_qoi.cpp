@@ -0,0 +1,220 @@
+#include "GBitmap_qoi.h"
+#include "../include/GTrace.h"
+
+#include <stdio.h>
+
+namespace {
+
+constexpr uint8_t kOpIndex = 0x00;  // 00xxxxxx
+constexpr uint8_t kOpDiff  = 0x40;  // 01xxxxxx
+constexpr uint8_t kOpLuma  = 0x80;  // 10xxxxxx
+constexpr uint8_t kOpRun   = 0xC0;  // 11xxxxxx
+constexpr uint8_t kOpRGB   = 0xFE;
+constexpr uint8_t kOpRGBA  = 0xFF;
+constexpr uint8_t kOpMask  = 0xC0;
+
+constexpr int kHeaderSize = 14;
+constexpr uint8_t kPadding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+constexpr int kMaxRun = 62;
+// keeps w * h * 5 well inside size_t, and matches the reference implementation's limit
+constexpr uint32_t kMaxPixels = 400000000;
+
+inline int hash(int r, int g, int b, int a) {
+    return (r * 3 + g * 5 + b * 7 + a * 11) & 63;
+}
+
+inline int hash(GPixel p) {
+    return hash(GPixel_GetR(p), GPixel_GetG(p), GPixel_GetB(p), GPixel_GetA(p));
+}
+
+void write_be32(uint8_t*& dst, uint32_t v) {
+    *dst++ = v >> 24;
+    *dst++ = v >> 16;
+    *dst++ = v >> 8;
+    *dst++ = v;
+}
+
+uint32_t read_be32(const uint8_t* src) {
+    return (uint32_t)src[0] << 24 | src[1] << 16 | src[2] << 8 | src[3];
+}
+
+}  // namespace
+
+bool GWriteQOI(const GBitmap& bm, const char path[]) {
+    GTRACE_SCOPE("writeQOI");
+    const int w = bm.width();
+    const int h = bm.height();
+    if (w <= 0 || h <= 0 || (uint64_t)w * h > kMaxPixels) {
+        return false;
+    }
+
+    // the worst case is every pixel as kOpRGBA
+    const size_t maxSize = kHeaderSize + (size_t)w * h * 5 + sizeof(kPadding);
+    uint8_t* storage = (uint8_t*)malloc(maxSize);
+    if (!storage) {
+        return false;
+    }
+    uint8_t* dst = storage;
+
+    *dst++ = 'q'; *dst++ = 'o'; *dst++ = 'i'; *dst++ = 'f';
+    write_be32(dst, w);
+    write_be32(dst, h);
+    *dst++ = 4;     // channels
+    *dst++ = 0;     // sRGB with linear alpha
+
+    GPixel index[64] = {};
+    GPixel prev = GPixel_PackARGB(0xFF, 0, 0, 0);
+    int run = 0;
+    {
+        GTRACE_SCOPE("encode");
+        for (int y = 0; y < h; ++y) {
+            const GPixel* row = bm.getAddr(0, y);
+            for (int x = 0; x < w; ++x) {
+                const GPixel px = row[x];
+                if (px == prev) {
+                    if (++run == kMaxRun) {
+                        *dst++ = kOpRun | (run - 1);
+                        run = 0;
+                    }
+                    continue;
+                }
+                if (run > 0) {
+                    *dst++ = kOpRun | (run - 1);
+                    run = 0;
+                }
+
+                const int r = GPixel_GetR(px), g = GPixel_GetG(px), b = GPixel_GetB(px);
+                const int a = GPixel_GetA(px);
+                const int slot = hash(r, g, b, a);
+                if (index[slot] == px) {
+                    *dst++ = kOpIndex | slot;
+                } else {
+                    index[slot] = px;
+                    if (a == GPixel_GetA(prev)) {
+                        // differences wrap around, as in the decoder
+                        const int8_t dr = (int8_t)(r - GPixel_GetR(prev));
+                        const int8_t dg = (int8_t)(g - GPixel_GetG(prev));
+                        const int8_t db = (int8_t)(b - GPixel_GetB(prev));
+                        const int8_t dr_dg = (int8_t)(dr - dg);
+                        const int8_t db_dg = (int8_t)(db - dg);
+                        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                            *dst++ = kOpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+                        } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 &&
+                                   db_dg >= -8 && db_dg <= 7) {
+                            *dst++ = kOpLuma | (dg + 32);
+                            *dst++ = (dr_dg + 8) << 4 | (db_dg + 8);
+                        } else {
+                            *dst++ = kOpRGB;
+                            *dst++ = r; *dst++ = g; *dst++ = b;
+                        }
+                    } else {
+                        *dst++ = kOpRGBA;
+                        *dst++ = r; *dst++ = g; *dst++ = b; *dst++ = a;
+                    }
+                }
+                prev = px;
+            }
+        }
+        if (run > 0) {
+            *dst++ = kOpRun | (run - 1);
+        }
+    }
+    memcpy(dst, kPadding, sizeof(kPadding));
+    dst += sizeof(kPadding);
+
+    bool ok = false;
+    if (FILE* f = fopen(path, "wb")) {
+        const size_t size = dst - storage;
+        ok = fwrite(storage, 1, size, f) == size;
+        ok = (fclose(f) == 0) && ok;
+    }
+    free(storage);
+    return ok;
+}
+
+bool GReadQOI(const char path[], GBitmap* bm) {
+    GTRACE_SCOPE("readQOI");
+    bm->reset();
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    const long fileSize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (fileSize < kHeaderSize + (long)sizeof(kPadding)) {
+        fclose(f);
+        return false;
+    }
+    uint8_t* data = (uint8_t*)malloc(fileSize);
+    const bool readAll = data && fread(data, 1, fileSize, f) == (size_t)fileSize;
+    fclose(f);
+    if (!readAll) {
+        free(data);
+        return false;
+    }
+
+    const uint32_t w = read_be32(data + 4);
+    const uint32_t h = read_be32(data + 8);
+    if (memcmp(data, "qoif", 4) || w == 0 || h == 0 || data[12] < 3 || data[12] > 4 ||
+        (uint64_t)w * h > kMaxPixels) {
+        free(data);
+        return false;
+    }
+
+    GPixel* pixels = (GPixel*)malloc((size_t)w * h * sizeof(GPixel));
+    if (!pixels) {
+        free(data);
+        return false;
+    }
+
+    GTRACE_SCOPE("decode");
+    // every op reads at most 5 bytes, and the padding is 8, so an op that starts before it stays
+    // inside the file
+    const uint8_t* src = data + kHeaderSize;
+    const uint8_t* chunksEnd = data + fileSize - sizeof(kPadding);
+    uint8_t index[64][4] = {};
+    uint8_t r = 0, g = 0, b = 0, a = 0xFF;
+    unsigned opaque = 0xFF;
+    int run = 0;
+
+    const size_t count = (size_t)w * h;
+    for (size_t i = 0; i < count; ++i) {
+        if (run > 0) {
+            run -= 1;
+        } else if (src < chunksEnd) {
+            const uint8_t op = *src++;
+            if (op == kOpRGB) {
+                r = src[0]; g = src[1]; b = src[2];
+                src += 3;
+            } else if (op == kOpRGBA) {
+                r = src[0]; g = src[1]; b = src[2]; a = src[3];
+                src += 4;
+            } else if ((op & kOpMask) == kOpIndex) {
+                r = index[op][0]; g = index[op][1]; b = index[op][2]; a = index[op][3];
+            } else if ((op & kOpMask) == kOpDiff) {
+                r += ((op >> 4) & 3) - 2;
+                g += ((op >> 2) & 3) - 2;
+                b += (op & 3) - 2;
+            } else if ((op & kOpMask) == kOpLuma) {
+                const int dg = (op & 0x3F) - 32;
+                const uint8_t next = *src++;
+                r += dg - 8 + ((next >> 4) & 0x0F);
+                g += dg;
+                b += dg - 8 + (next & 0x0F);
+            } else {
+                run = op & 0x3F;
+            }
+            uint8_t* slot = index[hash(r, g, b, a)];
+            slot[0] = r; slot[1] = g; slot[2] = b; slot[3] = a;
+        }
+        opaque &= a;
+        pixels[i] = GPixel_PackARGB(a, std::min(r, a), std::min(g, a), std::min(b, a));
+    }
+    free(data);
+
+    bm->reset(w, h, w * sizeof(GPixel), pixels,
+              opaque == 0xFF ? GBitmap::kYes_IsOpaque : GBitmap::kNo_IsOpaque);
+    return true;
+}
@@ -0,0 +1,22 @@
+#ifndef GBitmap_qoi_DEFINED
+#define GBitmap_qoi_DEFINED
+
+#include "../include/GBitmap.h"
+
+/**
+ *  QOI ("Quite OK Image", qoiformat.org) files, used by GBitmap::readFromFile() and writeToFile()
+ *  for paths ending in ".qoi".
+ *
+ *  The channels hold premultiplied colors -- GPixels as they are -- so a bitmap survives the
+ *  round trip exactly. Other tools read these files as unpremultiplied, which only matters for
+ *  translucent pixels.
+ */
+bool GWriteQOI(const GBitmap&, const char path[]);
+
+/**
+ *  Same contract as GBitmap::readFromFile(). Colors brighter than their alpha (possible in a
+ *  file written elsewhere) are clamped to it.
+ */
+bool GReadQOI(const char path[], GBitmap*);
+
+#endif
@@ -0,0 +1,127 @@
+#include "../include/GImageCache.h"
+#include "../include/GTrace.h"
+
+#include <sys/stat.h>
+
+static size_t image_bytes(const GBitmap& bm) {
+    return bm.height() * bm.rowBytes();
+}
+
+GImageCache::GImageCache(size_t byteBudget) : fBudget(byteBudget) {}
+
+GImageCache& GImageCache::Default() {
+    // never destroyed, so that images can still be found during static destruction
+    static GImageCache* cache = new GImageCache;
+    return *cache;
+}
+
+GImage GImageCache::find(const char path[]) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return nullptr;
+    }
+    const int64_t modified = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    const std::string key(path);
+
+    std::unique_lock<std::mutex> lock(fMutex);
+    bool waited = false;
+    for (;;) {
+        auto found = fEntries.find(key);
+        if (found == fEntries.end()) {
+            break;
+        }
+        Entry& entry = found->second;
+        if (!entry.fImage) {
+            // another thread is decoding it; its result may still be stale, so look again
+            if (!waited) {
+                fStats.fWaits += 1;
+                waited = true;
+            }
+            fDecoded.wait(lock);
+            continue;
+        }
+        if (entry.fModified == modified) {
+            fStats.fHits += 1;
+            fLRU.splice(fLRU.begin(), fLRU, entry.fLRU);
+            return entry.fImage;
+        }
+        // the file changed; whoever still uses the old image keeps it
+        this->evict(found);
+        break;
+    }
+
+    fStats.fMisses += 1;
+    fEntries[key] = {modified, nullptr, {}};
+    lock.unlock();
+
+    GImage image;
+    {
+        GTRACE_SCOPE("imageCacheDecode");
+        GBitmap bm;
+        if (bm.readFromFile(path)) {
+            image = GImage(new GBitmap(bm), [](const GBitmap* doomed) {
+                free(doomed->pixels());
+                delete doomed;
+            });
+        }
+    }
+
+    lock.lock();
+    // entries being decoded are never evicted, so it is still there
+    auto found = fEntries.find(key);
+    assert(found != fEntries.end() && !found->second.fImage);
+    if (image) {
+        Entry& entry = found->second;
+        entry.fImage = image;
+        fLRU.push_front(key);
+        entry.fLRU = fLRU.begin();
+        fUsed += image_bytes(*image);
+        this->evictOverBudget();
+    } else {
+        fEntries.erase(found);
+    }
+    fDecoded.notify_all();
+    return image;
+}
+
+void GImageCache::evict(EntryMap::iterator entry) {
+    assert(entry->second.fImage);
+    fUsed -= image_bytes(*entry->second.fImage);
+    fLRU.erase(entry->second.fLRU);
+    fEntries.erase(entry);
+}
+
+void GImageCache::evictOverBudget() {
+    while (fUsed > fBudget && !fLRU.empty()) {
+        this->evict(fEntries.find(fLRU.back()));
+        fStats.fEvictions += 1;
+    }
+}
+
+size_t GImageCache::byteBudget() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fBudget;
+}
+
+void GImageCache::setByteBudget(size_t budget) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fBudget = budget;
+    this->evictOverBudget();
+}
+
+size_t GImageCache::bytesUsed() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fUsed;
+}
+
+void GImageCache::purge() {
+    std::lock_guard<std::mutex> lock(fMutex);
+    while (!fLRU.empty()) {
+        this->evict(fEntries.find(fLRU.back()));
+    }
+}
+
+GImageCache::Stats GImageCache::stats() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fStats;
+}
@@ -0,0 +1,124 @@
+#include "../include/GOwnedBitmap.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Free blocks, bucketed by their exact size: the sizes that recur are the ones worth keeping.
+class BitmapPool {
+public:
+    void* acquire(size_t size) {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            auto bucket = fFree.find(size);
+            if (bucket != fFree.end() && !bucket->second.empty()) {
+                void* block = bucket->second.back();
+                bucket->second.pop_back();
+                fHeld -= size;
+                return block;
+            }
+        }
+        return aligned_alloc(GOwnedBitmap::kRowAlignment, size);
+    }
+
+    void release(void* block, size_t size) {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            if (fHeld + size <= fBudget) {
+                fFree[size].push_back(block);
+                fHeld += size;
+                return;
+            }
+        }
+        free(block);
+    }
+
+    void setBudget(size_t budget) {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fBudget = budget;
+        this->trim();
+    }
+
+    void purge() {
+        std::lock_guard<std::mutex> lock(fMutex);
+        size_t budget = fBudget;
+        fBudget = 0;
+        this->trim();
+        fBudget = budget;
+    }
+
+private:
+    // requires fMutex
+    void trim() {
+        for (auto it = fFree.begin(); it != fFree.end() && fHeld > fBudget;) {
+            std::vector<void*>& blocks = it->second;
+            while (!blocks.empty() && fHeld > fBudget) {
+                free(blocks.back());
+                blocks.pop_back();
+                fHeld -= it->first;
+            }
+            it = blocks.empty() ? fFree.erase(it) : std::next(it);
+        }
+    }
+
+    std::mutex fMutex;
+    std::unordered_map<size_t, std::vector<void*>> fFree;
+    size_t fHeld = 0;
+    size_t fBudget = 64 << 20;
+};
+
+BitmapPool& pool() {
+    // never destroyed, so that bitmaps can still be freed during static destruction
+    static BitmapPool* pool = new BitmapPool;
+    return *pool;
+}
+
+}  // namespace
+
+GOwnedBitmap::GOwnedBitmap(int width, int height, Init init) {
+    assert(width >= 0 && height >= 0);
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    const size_t rb = RowBytes(width);
+    const size_t size = rb * height;
+    GPixel* pixels = (GPixel*)pool().acquire(size);
+    if (!pixels) {
+        return;
+    }
+    if (init == kZero_Init) {
+        // recycled blocks hold old pixels, and fresh ones are not zeroed either
+        memset(pixels, 0, size);
+    }
+    fBitmap.reset(width, height, rb, pixels, GBitmap::kNo_IsOpaque);
+}
+
+GOwnedBitmap::GOwnedBitmap(GOwnedBitmap&& other) : fBitmap(other.fBitmap) {
+    other.fBitmap.reset();
+}
+
+GOwnedBitmap& GOwnedBitmap::operator=(GOwnedBitmap&& other) {
+    if (this != &other) {
+        this->reset();
+        fBitmap = other.fBitmap;
+        other.fBitmap.reset();
+    }
+    return *this;
+}
+
+void GOwnedBitmap::reset() {
+    if (fBitmap.pixels()) {
+        pool().release(fBitmap.pixels(), fBitmap.rowBytes() * fBitmap.height());
+    }
+    fBitmap.reset();
+}
+
+void GSetBitmapPoolBudget(size_t bytes) {
+    pool().setBudget(bytes);
+}
+
+void GPurgeBitmapPool() {
+    pool().purge();
+}
@@ -0,0 +1,32 @@
+#include "../include/GPicture.h"
+
+#include "../include/GRegion.h"
+#include "GRecordingCanvas.h"
+
+void GPicture::playback(GCanvas* canvas) const {
+    for (const auto& command : fCommands) {
+        command(canvas);
+    }
+}
+
+void GPicture::playback(GCanvas* canvas, const GRegion& clip) const {
+    canvas->save();
+    canvas->clipRegion(clip);
+    this->playback(canvas);
+    canvas->restore();
+}
+
+GPictureRecorder::GPictureRecorder()
+    : fPicture(new GPicture)
+    , fCanvas(new GRecordingCanvas([this](GRecordingCanvas::Call call) {
+        fPicture->fCommands.push_back(std::move(call));
+    }))
+{}
+
+GPictureRecorder::~GPictureRecorder() {}
+
+std::unique_ptr<GPicture> GPictureRecorder::finish() {
+    std::unique_ptr<GPicture> picture = std::move(fPicture);
+    fPicture.reset(new GPicture);
+    return picture;
+}
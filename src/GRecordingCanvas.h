@@ -0,0 +1,96 @@
+#ifndef GRecordingCanvas_DEFINED
+#define GRecordingCanvas_DEFINED
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "../include/GCanvas.h"
+#include "../include/GPath.h"
+#include "../include/GPoint.h"
+#include "../include/GRect.h"
+#include "../include/GRegion.h"
+
+/**
+ *  A canvas that draws nothing: each call is copied into a Call and handed to record, to be
+ *  played into another canvas later. Paths, points and colors are copied; shaders are referenced.
+ *  Shared by GRenderQueue and GPictureRecorder.
+ */
+class GRecordingCanvas : public GCanvas {
+public:
+    typedef std::function<void(GCanvas*)> Call;
+
+    explicit GRecordingCanvas(std::function<void(Call)> record) : fRecord(std::move(record)) {}
+
+    void save() override {
+        fRecord([](GCanvas* canvas) { canvas->save(); });
+    }
+
+    void restore() override {
+        fRecord([](GCanvas* canvas) { canvas->restore(); });
+    }
+
+    void concat(const GMatrix& matrix) override {
+        fRecord([matrix](GCanvas* canvas) { canvas->concat(matrix); });
+    }
+
+    void clipRect(const GRect& rect) override {
+        fRecord([rect](GCanvas* canvas) { canvas->clipRect(rect); });
+    }
+
+    void clipPath(const GPath& path) override {
+        fRecord([path](GCanvas* canvas) { canvas->clipPath(path); });
+    }
+
+    void clipRegion(const GRegion& region) override {
+        fRecord([region](GCanvas* canvas) { canvas->clipRegion(region); });
+    }
+
+    void clear(const GColor& color) override {
+        fRecord([color](GCanvas* canvas) { canvas->clear(color); });
+    }
+
+    void drawRect(const GRect& rect, const GPaint& paint) override {
+        fRecord([rect, paint](GCanvas* canvas) { canvas->drawRect(rect, paint); });
+    }
+
+    void drawConvexPolygon(const GPoint vertices[], int count, const GPaint& paint) override {
+        std::vector<GPoint> pts(vertices, vertices + std::max(count, 0));
+        fRecord([pts, paint](GCanvas* canvas) {
+            canvas->drawConvexPolygon(pts.data(), (int)pts.size(), paint);
+        });
+    }
+
+    void drawPath(const GPath& path, const GPaint& paint) override {
+        fRecord([path, paint](GCanvas* canvas) { canvas->drawPath(path, paint); });
+    }
+
+    void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
+                  int count, const int indices[], const GPaint& paint) override {
+        std::vector<int> idx(indices, indices + std::max(count, 0) * 3);
+        int n = idx.empty() ? 0 : *std::max_element(idx.begin(), idx.end()) + 1;
+        std::vector<GPoint> v(verts, verts + n);
+        std::vector<GColor> c = colors ? std::vector<GColor>(colors, colors + n) : std::vector<GColor>();
+        std::vector<GPoint> t = texs ? std::vector<GPoint>(texs, texs + n) : std::vector<GPoint>();
+        fRecord([v, c, t, idx, count, paint](GCanvas* canvas) {
+            canvas->drawMesh(v.data(), c.empty() ? nullptr : c.data(), t.empty() ? nullptr : t.data(),
+                             count, idx.data(), paint);
+        });
+    }
+
+    void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+                  int level, const GPaint& paint) override {
+        std::vector<GPoint> v(verts, verts + 4);
+        std::vector<GColor> c = colors ? std::vector<GColor>(colors, colors + 4) : std::vector<GColor>();
+        std::vector<GPoint> t = texs ? std::vector<GPoint>(texs, texs + 4) : std::vector<GPoint>();
+        fRecord([v, c, t, level, paint](GCanvas* canvas) {
+            canvas->drawQuad(v.data(), c.empty() ? nullptr : c.data(), t.empty() ? nullptr : t.data(),
+                             level, paint);
+        });
+    }
+
+private:
+    std::function<void(Call)> fRecord;
+};
+
+#endif
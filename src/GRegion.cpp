@@ -0,0 +1,281 @@
+#include "../include/GRegion.h"
+
+#include <climits>
+
+void GRegion::setEmpty() {
+    fBands.clear();
+    fSpans.clear();
+    fBounds = {0, 0, 0, 0};
+}
+
+void GRegion::setRect(const GIRect& r) {
+    this->setEmpty();
+    if (!r.isEmpty()) {
+        fBands.push_back({r.top, r.bottom, 0});
+        fSpans.push_back({r.left, r.right});
+        fBounds = r;
+    }
+}
+
+void GRegion::appendBand(int top, int bottom, const Span spans[], int count) {
+    if (count == 0 || top >= bottom) {
+        return;
+    }
+    if (!fBands.empty() && fBands.back().fBottom == top) {
+        const Band& last = fBands.back();
+        int lastCount = (int)fSpans.size() - last.fFirst;
+        if (lastCount == count && std::equal(spans, spans + count, fSpans.begin() + last.fFirst,
+                                             [](const Span& a, const Span& b) {
+                                                 return a.fLeft == b.fLeft && a.fRight == b.fRight;
+                                             })) {
+            fBands.back().fBottom = bottom;
+            return;
+        }
+    }
+    fBands.push_back({top, bottom, (int)fSpans.size()});
+    fSpans.insert(fSpans.end(), spans, spans + count);
+}
+
+void GRegion::computeBounds() {
+    if (fBands.empty()) {
+        fBounds = {0, 0, 0, 0};
+        return;
+    }
+    fBounds = GIRect::LTRB(INT_MAX, fBands.front().fTop, INT_MIN, fBands.back().fBottom);
+    for (size_t i = 0; i < fBands.size(); i++) {
+        fBounds.left = std::min(fBounds.left, fSpans[fBands[i].fFirst].fLeft);
+        fBounds.right = std::max(fBounds.right, fSpans[this->spanEnd(i) - 1].fRight);
+    }
+}
+
+static bool is_inside(bool inA, bool inB, GRegion::Op op) {
+    switch (op) {
+        case GRegion::kUnion_Op:
+            return inA || inB;
+        case GRegion::kIntersect_Op:
+            return inA && inB;
+        case GRegion::kDifference_Op:
+            return inA && !inB;
+    }
+    return false;
+}
+
+// Combine two rows of sorted, disjoint spans, appending the result to out.
+static void combine_spans(const GRegion::Span a[], int na, const GRegion::Span b[], int nb,
+                          GRegion::Op op, std::vector<GRegion::Span>* out) {
+    int i = 0, j = 0;
+    bool inA = false, inB = false;
+    int start = 0;
+    const size_t first = out->size();
+    while (i < na || j < nb) {
+        // the next place either row goes in or out
+        int xa = i < na ? (inA ? a[i].fRight : a[i].fLeft) : INT_MAX;
+        int xb = j < nb ? (inB ? b[j].fRight : b[j].fLeft) : INT_MAX;
+        int x = std::min(xa, xb);
+
+        bool wasInside = is_inside(inA, inB, op);
+        if (xa == x) {
+            i += inA;
+            inA = !inA;
+        }
+        if (xb == x) {
+            j += inB;
+            inB = !inB;
+        }
+        bool inside = is_inside(inA, inB, op);
+
+        if (!wasInside && inside) {
+            start = x;
+        } else if (wasInside && !inside) {
+            if (out->size() > first && out->back().fRight == start) {
+                out->back().fRight = x;     // touches the previous span
+            } else {
+                out->push_back({start, x});
+            }
+        }
+    }
+}
+
+bool GRegion::op(const GRegion& other, Op op) {
+    // the cases that need no sweep
+    switch (op) {
+        case kUnion_Op:
+            if (other.isEmpty()) {
+                return !this->isEmpty();
+            }
+            if (this->isEmpty() || (other.isRect() && other.contains(fBounds))) {
+                *this = other;
+                return true;
+            }
+            if (this->isRect() && this->contains(other.fBounds)) {
+                return true;
+            }
+            break;
+        case kIntersect_Op:
+            if (this->isEmpty() || other.isEmpty()) {
+                this->setEmpty();
+                return false;
+            }
+            if (this->isRect() && other.isRect()) {
+                const GIRect& a = fBounds;
+                const GIRect& b = other.fBounds;
+                this->setRect(GIRect::LTRB(std::max(a.left, b.left), std::max(a.top, b.top),
+                                           std::min(a.right, b.right), std::min(a.bottom, b.bottom)));
+                return !this->isEmpty();
+            }
+            break;
+        case kDifference_Op:
+            if (this->isEmpty() || other.isEmpty() || !other.intersects(fBounds)) {
+                return !this->isEmpty();
+            }
+            break;
+    }
+
+    // every y where either region's spans change
+    std::vector<int> ys;
+    ys.reserve(2 * (fBands.size() + other.fBands.size()));
+    for (const Band& band : fBands) {
+        ys.push_back(band.fTop);
+        ys.push_back(band.fBottom);
+    }
+    for (const Band& band : other.fBands) {
+        ys.push_back(band.fTop);
+        ys.push_back(band.fBottom);
+    }
+    std::sort(ys.begin(), ys.end());
+    ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+    GRegion result;
+    std::vector<Span> row;
+    size_t ia = 0, ib = 0;
+    for (size_t k = 0; k + 1 < ys.size(); k++) {
+        int top = ys[k];
+        int bottom = ys[k + 1];
+        while (ia < fBands.size() && fBands[ia].fBottom <= top) {
+            ia++;
+        }
+        while (ib < other.fBands.size() && other.fBands[ib].fBottom <= top) {
+            ib++;
+        }
+        const bool hasA = ia < fBands.size() && fBands[ia].fTop <= top;
+        const bool hasB = ib < other.fBands.size() && other.fBands[ib].fTop <= top;
+        const Span* a = hasA ? &fSpans[fBands[ia].fFirst] : nullptr;
+        const Span* b = hasB ? &other.fSpans[other.fBands[ib].fFirst] : nullptr;
+        int na = hasA ? this->spanEnd(ia) - fBands[ia].fFirst : 0;
+        int nb = hasB ? other.spanEnd(ib) - other.fBands[ib].fFirst : 0;
+
+        row.clear();
+        combine_spans(a, na, b, nb, op, &row);
+        result.appendBand(top, bottom, row.data(), (int)row.size());
+    }
+    result.computeBounds();
+    *this = std::move(result);
+    return !this->isEmpty();
+}
+
+const GRegion::Span* GRegion::row(int y, int* count) const {
+    auto band = std::upper_bound(fBands.begin(), fBands.end(), y, [](int y, const Band& band) {
+        return y < band.fBottom;
+    });
+    if (band == fBands.end() || band->fTop > y) {
+        *count = 0;
+        return nullptr;
+    }
+    *count = this->spanEnd(band - fBands.begin()) - band->fFirst;
+    return &fSpans[band->fFirst];
+}
+
+bool GRegion::contains(int x, int y) const {
+    int count;
+    const Span* spans = this->row(y, &count);
+    for (int i = 0; i < count && spans[i].fLeft <= x; i++) {
+        if (x < spans[i].fRight) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GRegion::contains(const GIRect& r) const {
+    if (r.isEmpty() || this->isEmpty() || r.left < fBounds.left || r.top < fBounds.top ||
+        r.right > fBounds.right || r.bottom > fBounds.bottom) {
+        return false;
+    }
+    if (this->isRect()) {
+        return true;
+    }
+    // the bands from r.top down must leave no gaps, and each must hold r's columns in one span
+    int y = r.top;
+    for (size_t i = 0; i < fBands.size() && y < r.bottom; i++) {
+        const Band& band = fBands[i];
+        if (band.fBottom <= y) {
+            continue;
+        }
+        if (band.fTop > y) {
+            return false;
+        }
+        bool covered = false;
+        for (int s = band.fFirst; s < this->spanEnd(i) && fSpans[s].fLeft <= r.left; s++) {
+            covered = fSpans[s].fRight >= r.right;
+        }
+        if (!covered) {
+            return false;
+        }
+        y = band.fBottom;
+    }
+    return y >= r.bottom;
+}
+
+bool GRegion::intersects(const GIRect& r) const {
+    if (r.isEmpty() || this->isEmpty() || r.right <= fBounds.left || r.bottom <= fBounds.top ||
+        r.left >= fBounds.right || r.top >= fBounds.bottom) {
+        return false;
+    }
+    if (this->isRect()) {
+        return true;
+    }
+    for (size_t i = 0; i < fBands.size() && fBands[i].fTop < r.bottom; i++) {
+        if (fBands[i].fBottom <= r.top) {
+            continue;
+        }
+        for (int s = fBands[i].fFirst; s < this->spanEnd(i) && fSpans[s].fLeft < r.right; s++) {
+            if (fSpans[s].fRight > r.left) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool GRegion::operator==(const GRegion& other) const {
+    // regions are always kept in their one canonical form
+    return fBands.size() == other.fBands.size() && fSpans.size() == other.fSpans.size() &&
+           std::equal(fBands.begin(), fBands.end(), other.fBands.begin(), [](const Band& a, const Band& b) {
+               return a.fTop == b.fTop && a.fBottom == b.fBottom && a.fFirst == b.fFirst;
+           }) &&
+           std::equal(fSpans.begin(), fSpans.end(), other.fSpans.begin(), [](const Span& a, const Span& b) {
+               return a.fLeft == b.fLeft && a.fRight == b.fRight;
+           });
+}
+
+void GRegion::Builder::addRow(int y, const Span spans[], int count) {
+    fRow.clear();
+    for (int i = 0; i < count; i++) {
+        if (spans[i].fLeft >= spans[i].fRight) {
+            continue;
+        }
+        if (!fRow.empty() && fRow.back().fRight >= spans[i].fLeft) {
+            fRow.back().fRight = std::max(fRow.back().fRight, spans[i].fRight);
+        } else {
+            fRow.push_back(spans[i]);
+        }
+    }
+    fRegion.appendBand(y, y + 1, fRow.data(), (int)fRow.size());
+}
+
+GRegion GRegion::Builder::detach() {
+    fRegion.computeBounds();
+    GRegion region = std::move(fRegion);
+    fRegion.setEmpty();
+    return region;
+}
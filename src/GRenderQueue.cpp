@@ -0,0 +1,164 @@
+#include "../include/GRenderQueue.h"
+
+#include <algorithm>
+#include <string>
+
+#include "../include/GBitmap.h"
+#include "../include/GOwnedBitmap.h"
+#include "GRecordingCanvas.h"
+
+struct GRenderQueue::Command {
+    enum Kind {
+        kBegin,
+        kDraw,
+        kEnd,
+        kQuit,
+    };
+
+    Kind fKind;
+    std::function<void(GCanvas*)> fDraw;  // kDraw
+    int fWidth = 0;                       // kBegin
+    int fHeight = 0;
+    std::string fPath;                    // kEnd
+    std::promise<bool> fDone;
+};
+
+/**
+ *  Canvas handed to the recording thread. It copies each call into a command instead of drawing.
+ */
+class GRenderQueue::Recorder : public GRecordingCanvas {
+public:
+    Recorder(GRenderQueue* queue)
+        : GRecordingCanvas([queue](std::function<void(GCanvas*)> draw) {
+            Command* cmd = new Command;
+            cmd->fKind = Command::kDraw;
+            cmd->fDraw = std::move(draw);
+            queue->push(cmd);
+        })
+    {}
+};
+
+static uint64_t round_up_pow2(int n) {
+    uint64_t size = 1;
+    while (size < (uint64_t)std::max(n, 2)) {
+        size <<= 1;
+    }
+    return size;
+}
+
+GRenderQueue::GRenderQueue(int capacity)
+    : fMask(round_up_pow2(capacity) - 1)
+    , fRing(fMask + 1, nullptr)
+    , fRecorder(new Recorder(this))
+    , fRenderThread([this]() { this->renderLoop(); })
+{}
+
+GRenderQueue::~GRenderQueue() {
+    Command* quit = new Command;
+    quit->fKind = Command::kQuit;
+    this->push(quit);
+    fRenderThread.join();
+    fEncoders.wait();
+}
+
+GCanvas* GRenderQueue::beginFrame(int width, int height) {
+    Command* cmd = new Command;
+    cmd->fKind = Command::kBegin;
+    cmd->fWidth = width;
+    cmd->fHeight = height;
+    this->push(cmd);
+    return fRecorder.get();
+}
+
+std::future<bool> GRenderQueue::endFrame(const char path[]) {
+    Command* cmd = new Command;
+    cmd->fKind = Command::kEnd;
+    cmd->fPath = path;
+    std::future<bool> future = cmd->fDone.get_future();
+    this->push(cmd);
+    return future;
+}
+
+// Called only by the recording thread.
+void GRenderQueue::push(Command* cmd) {
+    uint64_t tail = fTail.load(std::memory_order_relaxed);
+    while (tail - fHead.load(std::memory_order_acquire) > fMask) {
+        // ring is full: let the render thread catch up
+        std::this_thread::yield();
+    }
+    fRing[tail & fMask] = cmd;
+    fTail.store(tail + 1, std::memory_order_seq_cst);
+
+    if (fSleeping.load(std::memory_order_seq_cst)) {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+        }
+        fWake.notify_one();
+    }
+}
+
+// Called only by the render thread. Spins briefly, then sleeps until the recorder pushes.
+GRenderQueue::Command* GRenderQueue::pop() {
+    const int kSpinsBeforeSleep = 64;
+
+    uint64_t head = fHead.load(std::memory_order_relaxed);
+    int spins = 0;
+    while (fTail.load(std::memory_order_acquire) == head) {
+        if (++spins < kSpinsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(fMutex);
+        fSleeping.store(true, std::memory_order_seq_cst);
+        fWake.wait(lock, [this, head]() {
+            return fTail.load(std::memory_order_seq_cst) != head;
+        });
+        fSleeping.store(false, std::memory_order_relaxed);
+    }
+    Command* cmd = fRing[head & fMask];
+    fHead.store(head + 1, std::memory_order_release);
+    return cmd;
+}
+
+void GRenderQueue::renderLoop() {
+    GOwnedBitmap bitmap;
+    std::unique_ptr<GCanvas> canvas;
+
+    for (;;) {
+        Command* cmd = this->pop();
+        switch (cmd->fKind) {
+            case Command::kBegin:
+                // frames of one size keep recycling the same few blocks from the pool
+                bitmap = GOwnedBitmap(std::max(cmd->fWidth, 0), std::max(cmd->fHeight, 0));
+                // the canvas is destroyed, writing out any clear, before the bitmap is encoded
+                canvas = GCreateDeferredCanvas(bitmap);
+                delete cmd;
+                break;
+            case Command::kDraw:
+                if (canvas) {
+                    cmd->fDraw(canvas.get());
+                }
+                delete cmd;
+                break;
+            case Command::kEnd: {
+                if (!canvas) {
+                    cmd->fDone.set_value(false);
+                    delete cmd;
+                    break;
+                }
+                canvas.reset();
+                // the encoder now owns the pixels; the next frame gets a fresh bitmap
+                GOwnedBitmap* frame = new GOwnedBitmap(std::move(bitmap));
+                fEncoders.run([cmd, frame]() {
+                    cmd->fDone.set_value(frame->bitmap().writeToFile(cmd->fPath.c_str()));
+                    delete frame;
+                    delete cmd;
+                });
+                break;
+            }
+            case Command::kQuit:
+                delete cmd;
+                return;
+        }
+    }
+}
@@ -0,0 +1,317 @@
+#include "../include/GScene.h"
+
+#include <algorithm>
+
+#include "../include/GPath.h"
+#include "../include/GPoint.h"
+#include "GBVH.h"
+
+static const int kTileShift = 6;
+
+struct GScene::Node {
+    enum Kind {
+        kRect,
+        kPath,
+        kMesh,
+    };
+
+    Kind fKind;
+    GMatrix fMatrix;
+    GPaint fPaint;
+
+    GRect fRect;                    // kRect
+    GPath fPath;                    // kPath
+    std::vector<GPoint> fVerts;     // kMesh
+    std::vector<GColor> fColors;
+    std::vector<GPoint> fTexs;
+    std::vector<int> fIndices;
+    int fCount = 0;
+
+    // Device geometry, used instead of fMatrix when there is no shader to map too. A rect under a
+    // scale/translate stays a rect (fDeviceRect), as drawRect would make it; any other matrix
+    // turns it into a polygon (fDevicePts).
+    bool fPrepared = false;
+    bool fDeviceIsRect = false;
+    GRect fDeviceRect;
+    GPoint fDevicePts[4];
+    GPath fDevicePath;
+
+    bool fChanged = false;
+    GIRect fOldBounds;              // its bounds at the last render, while fChanged
+};
+
+// the 64x64 tiles r touches, within the device
+static GIRect tile_bounds(const GIRect& r, const GBitmap& device) {
+    if (r.isEmpty()) {
+        return GIRect::LTRB(0, 0, 0, 0);
+    }
+    const int mask = (1 << kTileShift) - 1;
+    return GIRect::LTRB(r.left & ~mask, r.top & ~mask,
+                        std::min((r.right + mask) & ~mask, device.width()),
+                        std::min((r.bottom + mask) & ~mask, device.height()));
+}
+
+// the pixels whose centers may be inside bounds, within the device
+static GIRect device_pixels(const GRect& bounds, const GBitmap& device) {
+    // clamp before rounding, so that huge (or NaN) coordinates become the device's
+    GRect r = GRect::LTRB(std::max(0.0f, bounds.left), std::max(0.0f, bounds.top),
+                          std::min((float)device.width(), bounds.right),
+                          std::min((float)device.height(), bounds.bottom));
+    return r.isEmpty() ? GIRect::LTRB(0, 0, 0, 0) : r.roundOut();
+}
+
+static GRect points_bounds(const GPoint pts[], int count) {
+    if (count <= 0) {
+        return GRect::LTRB(0, 0, 0, 0);
+    }
+    GRect bounds = GRect::LTRB(pts[0].x, pts[0].y, pts[0].x, pts[0].y);
+    for (int i = 1; i < count; i++) {
+        bounds.left = std::min(bounds.left, pts[i].x);
+        bounds.top = std::min(bounds.top, pts[i].y);
+        bounds.right = std::max(bounds.right, pts[i].x);
+        bounds.bottom = std::max(bounds.bottom, pts[i].y);
+    }
+    return bounds;
+}
+
+GScene::GScene(const GBitmap& device, const GColor& background)
+    : fDevice(device)
+    , fBackground(background)
+    , fCanvas(GCreateDeferredCanvas(device))
+    , fTree(new GBVH)
+{}
+
+GScene::~GScene() {}
+
+GScene::ID GScene::addRect(const GRect& rect, const GPaint& paint, const GMatrix& matrix) {
+    Node* node = new Node;
+    node->fKind = Node::kRect;
+    node->fRect = rect;
+    node->fPaint = paint;
+    node->fMatrix = matrix;
+    return this->add(node);
+}
+
+GScene::ID GScene::addPath(const GPath& path, const GPaint& paint, const GMatrix& matrix) {
+    Node* node = new Node;
+    node->fKind = Node::kPath;
+    node->fPath = path;
+    node->fPaint = paint;
+    node->fMatrix = matrix;
+    return this->add(node);
+}
+
+GScene::ID GScene::addMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count,
+                           const int indices[], const GPaint& paint, const GMatrix& matrix) {
+    Node* node = new Node;
+    node->fKind = Node::kMesh;
+    node->fIndices.assign(indices, indices + std::max(count, 0) * 3);
+    int n = node->fIndices.empty() ? 0 : *std::max_element(node->fIndices.begin(), node->fIndices.end()) + 1;
+    node->fVerts.assign(verts, verts + n);
+    if (colors) {
+        node->fColors.assign(colors, colors + n);
+    }
+    if (texs) {
+        node->fTexs.assign(texs, texs + n);
+    }
+    node->fCount = std::max(count, 0);
+    node->fPaint = paint;
+    node->fMatrix = matrix;
+    return this->add(node);
+}
+
+GScene::ID GScene::add(Node* node) {
+    const ID id = (ID)fNodes.size();
+    fNodes.emplace_back(node);
+    fBounds.push_back(GIRect::LTRB(0, 0, 0, 0));
+    fTreeStale = true;
+    this->changed(id);
+    return id;
+}
+
+void GScene::setMatrix(ID id, const GMatrix& matrix) {
+    if (id >= 0 && id < (ID)fNodes.size() && fNodes[id]) {
+        fNodes[id]->fMatrix = matrix;
+        this->changed(id);
+    }
+}
+
+void GScene::setPaint(ID id, const GPaint& paint) {
+    if (id >= 0 && id < (ID)fNodes.size() && fNodes[id]) {
+        fNodes[id]->fPaint = paint;
+        this->changed(id);
+    }
+}
+
+void GScene::setRect(ID id, const GRect& rect) {
+    if (id >= 0 && id < (ID)fNodes.size() && fNodes[id]) {
+        assert(fNodes[id]->fKind == Node::kRect);
+        fNodes[id]->fRect = rect;
+        this->changed(id);
+    }
+}
+
+void GScene::setPath(ID id, const GPath& path) {
+    if (id >= 0 && id < (ID)fNodes.size() && fNodes[id]) {
+        assert(fNodes[id]->fKind == Node::kPath);
+        fNodes[id]->fPath = path;
+        this->changed(id);
+    }
+}
+
+void GScene::invalidate(ID id) {
+    if (id >= 0 && id < (ID)fNodes.size() && fNodes[id]) {
+        this->changed(id);
+    }
+}
+
+void GScene::remove(ID id) {
+    if (id < 0 || id >= (ID)fNodes.size() || !fNodes[id]) {
+        return;
+    }
+    // what it covered, and what it covered when last painted if it has moved since
+    fRemoved.op(tile_bounds(fBounds[id], fDevice), GRegion::kUnion_Op);
+    if (fNodes[id]->fChanged) {
+        fRemoved.op(tile_bounds(fNodes[id]->fOldBounds, fDevice), GRegion::kUnion_Op);
+    }
+    fNodes[id].reset();
+    fBounds[id] = GIRect::LTRB(0, 0, 0, 0);
+    fMoves += 1;
+}
+
+GIRect GScene::bounds(ID id) const {
+    return id >= 0 && id < (ID)fBounds.size() ? fBounds[id] : GIRect::LTRB(0, 0, 0, 0);
+}
+
+void GScene::changed(ID id) {
+    Node* node = fNodes[id].get();
+    if (!node->fChanged) {
+        node->fChanged = true;
+        node->fOldBounds = fBounds[id];
+        fChanged.push_back(id);
+    }
+    GIRect bounds = this->prepare(node);
+    const GIRect& old = fBounds[id];
+    if (bounds.left != old.left || bounds.top != old.top || bounds.right != old.right || bounds.bottom != old.bottom) {
+        fBounds[id] = bounds;
+        fMoves += 1;
+    }
+}
+
+GIRect GScene::prepare(Node* node) const {
+    const GMatrix& m = node->fMatrix;
+    node->fPrepared = !node->fPaint.getShader() && node->fKind != Node::kMesh;
+
+    switch (node->fKind) {
+        case Node::kRect: {
+            const GRect& r = node->fRect;
+            GPoint* pts = node->fDevicePts;
+            pts[0] = {r.left, r.top};
+            pts[1] = {r.right, r.top};
+            pts[2] = {r.right, r.bottom};
+            pts[3] = {r.left, r.bottom};
+            m.mapPoints(pts, 4);
+            node->fDeviceIsRect = m[1] == 0 && m[2] == 0;
+            node->fDeviceRect = GRect::LTRB(pts[0].x, pts[0].y, pts[2].x, pts[2].y);
+            return device_pixels(points_bounds(pts, 4), fDevice);
+        }
+        case Node::kPath: {
+            node->fDevicePath = node->fPath;
+            node->fDevicePath.transform(m);
+            return device_pixels(node->fDevicePath.bounds(GPath::kControlPoints_BoundsType), fDevice);
+        }
+        case Node::kMesh: {
+            std::vector<GPoint> pts(node->fVerts);
+            m.mapPoints(pts.data(), (int)pts.size());
+            return device_pixels(points_bounds(pts.data(), (int)pts.size()), fDevice);
+        }
+    }
+    return GIRect::LTRB(0, 0, 0, 0);
+}
+
+void GScene::draw(const Node& node) {
+    GCanvas* canvas = fCanvas.get();
+    if (node.fPrepared) {
+        if (node.fKind == Node::kPath) {
+            canvas->drawPath(node.fDevicePath, node.fPaint);
+        } else if (node.fDeviceIsRect) {
+            canvas->drawRect(node.fDeviceRect, node.fPaint);
+        } else {
+            canvas->drawConvexPolygon(node.fDevicePts, 4, node.fPaint);
+        }
+        return;
+    }
+
+    canvas->save();
+    canvas->concat(node.fMatrix);
+    switch (node.fKind) {
+        case Node::kRect:
+            canvas->drawRect(node.fRect, node.fPaint);
+            break;
+        case Node::kPath:
+            canvas->drawPath(node.fPath, node.fPaint);
+            break;
+        case Node::kMesh:
+            canvas->drawMesh(node.fVerts.data(), node.fColors.empty() ? nullptr : node.fColors.data(),
+                             node.fTexs.empty() ? nullptr : node.fTexs.data(), node.fCount,
+                             node.fIndices.data(), node.fPaint);
+            break;
+    }
+    canvas->restore();
+}
+
+GRegion GScene::render() {
+    GRegion dirty;
+    if (!fCanvas) {
+        return dirty;
+    }
+    if (!fPainted) {
+        dirty.setRect(GIRect::WH(fDevice.width(), fDevice.height()));
+    } else {
+        dirty = fRemoved;
+        for (ID id : fChanged) {
+            if (fNodes[id]) {
+                dirty.op(tile_bounds(fNodes[id]->fOldBounds, fDevice), GRegion::kUnion_Op);
+                dirty.op(tile_bounds(fBounds[id], fDevice), GRegion::kUnion_Op);
+            }
+        }
+    }
+
+    // a refit tree answers correctly, but slowly once much of the scene has moved
+    if (fTreeStale || fMoves > fTree->count() / 4) {
+        fTree->build(fBounds);
+        fTreeStale = false;
+        fMoves = 0;
+    } else if (fMoves > 0) {
+        fTree->refit(fBounds);
+    }
+
+    if (!dirty.isEmpty()) {
+        std::vector<ID> nodes;
+        dirty.forEachRect([&](const GIRect& r) {
+            fTree->query(r, [&](int id) { nodes.push_back(id); });
+        });
+        // painter's order, each once
+        std::sort(nodes.begin(), nodes.end());
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+        fCanvas->save();
+        fCanvas->clipRegion(dirty);
+        fCanvas->clear(fBackground);
+        for (ID id : nodes) {
+            this->draw(*fNodes[id]);
+        }
+        fCanvas->restore();
+        fCanvas->flush();
+    }
+
+    for (ID id : fChanged) {
+        if (fNodes[id]) {
+            fNodes[id]->fChanged = false;
+        }
+    }
+    fChanged.clear();
+    fRemoved.setEmpty();
+    fPainted = true;
+    return dirty;
+}
@@ -0,0 +1,372 @@
+#include "../include/GScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// A queued unit of work. The same task may be queued more than once (see RangeTask); each time
+// it is taken, fRun runs it once, and may free it.
+struct Task {
+    void              (*fRun)(Task*);
+    std::atomic<int>*   fPending;   // decremented after each run
+    void*               fContext;   // the submitter's GGetTaskContext(), installed while it runs
+};
+
+// GTaskGroup::run()'s work, which owns itself
+struct FunctionTask : Task {
+    std::function<void()> fWork;
+
+    static void Run(Task* task) {
+        FunctionTask* self = static_cast<FunctionTask*>(task);
+        self->fWork();
+        delete self;
+    }
+};
+
+// GParallelFor's chunks. One task, owned by the caller, is queued once per helper; whoever takes
+// it claims chunks until none are left, so no chunk needs a task of its own.
+struct RangeTask : Task {
+    const std::function<void(int, int)>* fFn;
+    std::atomic<int> fNext;     // start of the next unclaimed chunk
+    int fEnd;
+    int fGrain;
+
+    static void Run(Task* task) {
+        RangeTask* self = static_cast<RangeTask*>(task);
+        for (;;) {
+            int start = self->fNext.fetch_add(self->fGrain, std::memory_order_relaxed);
+            if (start >= self->fEnd) {
+                return;
+            }
+            (*self->fFn)(start, std::min(start + self->fGrain, self->fEnd));
+        }
+    }
+};
+
+/**
+ *  Chase-Lev deque (Le, Pop, Cohen, Zappa Nardelli 2013). Only the owning worker calls push()
+ *  and pop(), which work on the bottom; any other thread may steal() from the top.
+ *  The ring has a fixed capacity: push() returns false when it is full and the caller runs
+ *  the task itself.
+ */
+class WorkDeque {
+public:
+    bool push(Task* task) {
+        int64_t b = fBottom.load(std::memory_order_relaxed);
+        int64_t t = fTop.load(std::memory_order_acquire);
+        if (b - t >= kCapacity) {
+            return false;
+        }
+        fTasks[b & kMask].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        fBottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    Task* pop() {
+        int64_t b = fBottom.load(std::memory_order_relaxed) - 1;
+        fBottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = fTop.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            fBottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Task* task = fTasks[b & kMask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // last task: race the thieves for it
+            if (!fTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                task = nullptr;
+            }
+            fBottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    Task* steal() {
+        int64_t t = fTop.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = fBottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        Task* task = fTasks[t & kMask].load(std::memory_order_relaxed);
+        if (!fTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return task;
+    }
+
+private:
+    static constexpr int64_t kCapacity = 1024;
+    static constexpr int64_t kMask = kCapacity - 1;
+
+    alignas(64) std::atomic<int64_t> fTop{0};
+    alignas(64) std::atomic<int64_t> fBottom{0};
+    std::atomic<Task*> fTasks[kCapacity] = {};
+};
+
+thread_local int tWorkerIndex = -1;
+thread_local void* tContext = nullptr;
+
+class Scheduler {
+public:
+    Scheduler(int workers) : fDeques(workers) {
+        for (int i = 0; i < workers; i++) {
+            fThreads.emplace_back([this, i]() { this->workerLoop(i); });
+        }
+    }
+
+    ~Scheduler() {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fStop = true;
+        }
+        fWake.notify_all();
+        for (auto& thread : fThreads) {
+            thread.join();
+        }
+    }
+
+    int workerCount() const { return (int)fThreads.size(); }
+
+    // Queue the task (copies times) on the calling worker's own deque, or on the shared queue for
+    // outside threads.
+    void submit(Task* task, int copies = 1) {
+        for (int i = 0; i < copies; i++) {
+            if (tWorkerIndex < 0 || !fDeques[tWorkerIndex].push(task)) {
+                std::lock_guard<std::mutex> lock(fMutex);
+                fInjected.push_back(task);
+            }
+        }
+        fQueued.fetch_add(copies);
+        // Sleepers count themselves under fMutex before checking fQueued, so either they see the
+        // new tasks or we see them and take the lock, which waits until they are asleep.
+        const bool idle = fIdle.load() > 0;
+        const bool waiting = fWaiting.load() > 0;
+        if (idle || waiting) {
+            {
+                std::lock_guard<std::mutex> lock(fMutex);
+            }
+            if (idle) {
+                copies > 1 ? fWake.notify_all() : fWake.notify_one();
+            }
+            if (waiting) {
+                fDone.notify_all();
+            }
+        }
+    }
+
+    // Run queued tasks on the calling thread until the counter drains, sleeping while there are
+    // none to take.
+    void wait(std::atomic<int>& pending) {
+        while (pending.load(std::memory_order_acquire) > 0) {
+            if (Task* task = this->findTask(tWorkerIndex)) {
+                this->run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(fMutex);
+            fWaiting.fetch_add(1);
+            fDone.wait(lock, [&]() { return pending.load() == 0 || fQueued.load() > 0; });
+            fWaiting.fetch_sub(1);
+        }
+    }
+
+private:
+    std::deque<WorkDeque>    fDeques;
+    std::vector<std::thread> fThreads;
+    std::deque<Task*>        fInjected;
+    std::atomic<int>         fQueued{0};
+    std::atomic<int>         fIdle{0};      // workers asleep on fWake
+    std::atomic<int>         fWaiting{0};   // wait() callers asleep on fDone
+    std::mutex               fMutex;
+    std::condition_variable  fWake;
+    std::condition_variable  fDone;
+    bool                     fStop = false;
+
+    void run(Task* task) {
+        // the task may be gone once it has run
+        std::atomic<int>* pending = task->fPending;
+        void* outer = tContext;
+        tContext = task->fContext;
+        task->fRun(task);
+        tContext = outer;
+        if (pending->fetch_sub(1, std::memory_order_acq_rel) == 1 && fWaiting.load() > 0) {
+            {
+                std::lock_guard<std::mutex> lock(fMutex);
+            }
+            fDone.notify_all();
+        }
+    }
+
+    Task* findTask(int self) {
+        if (fQueued.load() == 0) {
+            return nullptr;
+        }
+        Task* task = nullptr;
+        if (self >= 0) {
+            task = fDeques[self].pop();
+        }
+        for (int i = 1; !task && i <= (int)fDeques.size(); i++) {
+            int victim = (self + i) % (int)fDeques.size();
+            if (victim != self) {
+                task = fDeques[victim].steal();
+            }
+        }
+        if (!task) {
+            std::lock_guard<std::mutex> lock(fMutex);
+            if (!fInjected.empty()) {
+                task = fInjected.front();
+                fInjected.pop_front();
+            }
+        }
+        if (task) {
+            fQueued.fetch_sub(1);
+        }
+        return task;
+    }
+
+    void workerLoop(int index) {
+        tWorkerIndex = index;
+        for (;;) {
+            if (Task* task = this->findTask(index)) {
+                this->run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(fMutex);
+            fIdle.fetch_add(1);
+            fWake.wait(lock, [this]() { return fStop || fQueued.load() > 0; });
+            fIdle.fetch_sub(1);
+            if (fStop) {
+                return;
+            }
+        }
+    }
+};
+
+int default_worker_count() {
+    return std::max(0, (int)std::thread::hardware_concurrency() - 1);
+}
+
+// Published through an atomic so that finding it never locks; gSchedulerMutex only serializes
+// creating and replacing it, which GSetWorkerCount() requires no work to be in flight for.
+std::mutex gSchedulerMutex;
+std::atomic<Scheduler*> gScheduler{nullptr};
+
+// joins the workers at exit
+struct SchedulerOwner {
+    ~SchedulerOwner() { delete gScheduler.exchange(nullptr); }
+} gSchedulerOwner;
+
+Scheduler& get_scheduler() {
+    Scheduler* scheduler = gScheduler.load(std::memory_order_acquire);
+    if (!scheduler) {
+        std::lock_guard<std::mutex> lock(gSchedulerMutex);
+        scheduler = gScheduler.load(std::memory_order_relaxed);
+        if (!scheduler) {
+            scheduler = new Scheduler(default_worker_count());
+            gScheduler.store(scheduler, std::memory_order_release);
+        }
+    }
+    return *scheduler;
+}
+
+// rows are handed out in chunks of at least this many pixels
+constexpr int kMinPixelsPerTask = 1 << 16;
+
+}  // namespace
+
+int GGetWorkerCount() {
+    return get_scheduler().workerCount();
+}
+
+int GGetWorkerIndex() {
+    return tWorkerIndex;
+}
+
+void* GGetTaskContext() {
+    return tContext;
+}
+
+void GSetTaskContext(void* context) {
+    tContext = context;
+}
+
+void GSetWorkerCount(int count) {
+    if (count < 0) {
+        count = default_worker_count();
+    }
+    std::lock_guard<std::mutex> lock(gSchedulerMutex);
+    Scheduler* old = gScheduler.load(std::memory_order_relaxed);
+    if (!old || old->workerCount() != count) {
+        // the old workers are joined before the new ones start
+        delete gScheduler.exchange(nullptr);
+        gScheduler.store(new Scheduler(count), std::memory_order_release);
+    }
+}
+
+void GTaskGroup::run(std::function<void()> work) {
+    Scheduler& scheduler = get_scheduler();
+    if (scheduler.workerCount() == 0) {
+        work();
+        return;
+    }
+    FunctionTask* task = new FunctionTask;
+    task->fRun = FunctionTask::Run;
+    task->fPending = &fPending;
+    task->fContext = tContext;
+    task->fWork = std::move(work);
+    fPending.fetch_add(1);
+    scheduler.submit(task);
+}
+
+void GTaskGroup::wait() {
+    if (fPending.load(std::memory_order_acquire) > 0) {
+        get_scheduler().wait(fPending);
+    }
+}
+
+void GParallelFor(int begin, int end, int grain, const std::function<void(int start, int stop)>& fn) {
+    if (begin >= end) {
+        return;
+    }
+    grain = std::max(grain, 1);
+
+    Scheduler& scheduler = get_scheduler();
+    if (scheduler.workerCount() == 0 || end - begin <= grain) {
+        fn(begin, end);
+        return;
+    }
+
+    RangeTask task;
+    std::atomic<int> pending;
+    task.fRun = RangeTask::Run;
+    task.fPending = &pending;
+    task.fContext = tContext;
+    task.fFn = &fn;
+    task.fNext.store(begin, std::memory_order_relaxed);
+    task.fEnd = end;
+    task.fGrain = grain;
+
+    // the calling thread claims chunks too, so it needs at most one helper per other chunk
+    const int64_t chunks = ((int64_t)end - begin + grain - 1) / grain;
+    const int helpers = (int)std::min<int64_t>(scheduler.workerCount(), chunks - 1);
+    pending.store(helpers, std::memory_order_relaxed);
+    scheduler.submit(&task, helpers);
+    RangeTask::Run(&task);
+    // helpers that take the task after the last chunk was claimed return at once
+    scheduler.wait(pending);
+}
+
+void GParallelForRows(int top, int bottom, int width, const std::function<void(int y0, int y1)>& fn) {
+    int grain = kMinPixelsPerTask / std::max(width, 1);
+    GParallelFor(top, bottom, std::max(grain, 1), fn);
+}
@@ -0,0 +1,162 @@
+#include "../include/GTrace.h"
+
+#ifdef G_TRACE
+
+#include "../include/GScheduler.h"
+#include <mutex>
+#include <string>
+
+std::atomic<int> GTraceScope::gTraceLevel{(int)GTraceLevel::kOff};
+
+namespace {
+
+struct Event {
+    const char* fName;
+    GNSec       fStart;
+    GNSec       fEnd;
+};
+
+// Events are appended to a list of fixed-size chunks, so that a full buffer grows without
+// moving the events already published to the reader.
+struct Chunk {
+    static constexpr int kCapacity = 4096;
+
+    Event               fEvents[kCapacity];
+    std::atomic<int>    fCount{0};
+    std::atomic<Chunk*> fNext{nullptr};
+};
+
+class ThreadBuffer {
+public:
+    ThreadBuffer(int tid, std::string name) : fTid(tid), fName(std::move(name)) {
+        fHead = fTail = new Chunk;
+    }
+    ~ThreadBuffer() {
+        this->freeChunks(fHead);
+    }
+
+    // only called by the owning thread
+    void append(const char name[], GNSec start, GNSec end) {
+        int n = fTail->fCount.load(std::memory_order_relaxed);
+        if (n == Chunk::kCapacity) {
+            Chunk* chunk = new Chunk;
+            fTail->fNext.store(chunk, std::memory_order_release);
+            fTail = chunk;
+            n = 0;
+        }
+        fTail->fEvents[n] = {name, start, end};
+        fTail->fCount.store(n + 1, std::memory_order_release);
+    }
+
+    template <typename Visit> void forEach(Visit visit) const {
+        for (const Chunk* c = fHead; c; c = c->fNext.load(std::memory_order_acquire)) {
+            int count = c->fCount.load(std::memory_order_acquire);
+            for (int i = 0; i < count; ++i) {
+                visit(c->fEvents[i]);
+            }
+        }
+    }
+
+    // the owning thread must not be appending
+    void reset() {
+        this->freeChunks(fHead->fNext.load(std::memory_order_relaxed));
+        fHead->fNext.store(nullptr, std::memory_order_relaxed);
+        fHead->fCount.store(0, std::memory_order_relaxed);
+        fTail = fHead;
+    }
+
+    int tid() const { return fTid; }
+    const std::string& name() const { return fName; }
+
+private:
+    void freeChunks(Chunk* c) {
+        while (c) {
+            Chunk* next = c->fNext.load(std::memory_order_relaxed);
+            delete c;
+            c = next;
+        }
+    }
+
+    const int         fTid;
+    const std::string fName;
+    Chunk*            fHead;
+    Chunk*            fTail;
+};
+
+// Buffers outlive their threads, so events from finished threads still make it into the file.
+std::mutex gRegistryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> gBuffers;
+std::atomic<GNSec> gEpoch{0};
+
+thread_local ThreadBuffer* tBuffer = nullptr;
+
+ThreadBuffer* thread_buffer() {
+    if (!tBuffer) {
+        std::lock_guard<std::mutex> lock(gRegistryMutex);
+        int tid = (int)gBuffers.size() + 1;
+        int worker = GGetWorkerIndex();
+        std::string name = worker >= 0 ? "worker " + std::to_string(worker)
+                                       : "thread " + std::to_string(tid);
+        gBuffers.emplace_back(new ThreadBuffer(tid, name));
+        tBuffer = gBuffers.back().get();
+    }
+    return tBuffer;
+}
+
+}  // namespace
+
+void GTraceScope::Record(const char name[], GNSec start, GNSec end) {
+    thread_buffer()->append(name, start, end);
+}
+
+bool GTraceIsCompiledIn() {
+    return true;
+}
+
+void GTraceSetLevel(GTraceLevel level) {
+    GNSec zero = 0;
+    gEpoch.compare_exchange_strong(zero, GTime::GetNSec());
+    GTraceScope::gTraceLevel.store((int)level, std::memory_order_relaxed);
+}
+
+bool GTraceWriteFile(const char path[]) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    const GNSec epoch = gEpoch.load();
+    const char* sep = "";
+
+    fprintf(f, "{\"traceEvents\": [\n");
+    for (const auto& buffer : gBuffers) {
+        fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                   "\"args\": {\"name\": \"%s\"}}",
+                sep, buffer->tid(), buffer->name().c_str());
+        sep = ",\n";
+        buffer->forEach([&](const Event& e) {
+            fprintf(f, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                       "\"ts\": %.3f, \"dur\": %.3f}",
+                    e.fName, buffer->tid(), (e.fStart - epoch) / 1000.0,
+                    (e.fEnd - e.fStart) / 1000.0);
+        });
+        buffer->reset();
+    }
+    fprintf(f, "\n], \"displayTimeUnit\": \"ns\"}\n");
+    return fclose(f) == 0;
+}
+
+#else
+
+bool GTraceIsCompiledIn() {
+    return false;
+}
+
+void GTraceSetLevel(GTraceLevel) {}
+
+bool GTraceWriteFile(const char path[]) {
+    return false;
+}
+
+#endif